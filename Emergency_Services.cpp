@@ -1,15 +1,54 @@
 #include <iostream>
+#include <string>
 #include <vector>
 #include <queue>
+#include <list>
 #include <unordered_map>
 #include <climits>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 // Function prototypes
 class Stack;
+class GraphBuilder;
+class ContractionHierarchy;
+class HierarchyContractor;
+class WeightReader;
 class Graph;
 class CrowdControl;
+class MappedFile;
+void buildGridCity(Graph& graph, int width, int height, unsigned seed);
+bool writeGridEdgeList(const string& path, int side, unsigned seed);
+int runGraphBenchmark(int argc, char* argv[]);
+long long routeLength(Graph& graph, const vector<int>& path);
+int runHierarchyBenchmark(int argc, char* argv[]);
+int runDispatchBenchmark(int argc, char* argv[]);
+int runUpdateBenchmark(int argc, char* argv[]);
+int runSearchBenchmark(int argc, char* argv[]);
+int runQueueBenchmark(int argc, char* argv[]);
+int runCacheBenchmark(int argc, char* argv[]);
+bool loadRoadNetwork(Graph& graph, int argc, char* argv[], bool& menu);
+uint64_t cacheChecksum(const char* data, size_t bytes, uint64_t hash);
 
 class Stack {
     vector<string> stack;
@@ -23,177 +62,2785 @@ public:
     void display();
 };
 
+// A road between two locations, by location ID, waiting to be frozen into the graph
+struct BuilderEdge {
+    int from;
+    int to;
+    int weight;
+};
+
+uint64_t nameHash(string_view name) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (char c : name) hash = (hash ^ (unsigned char)c) * 1099511628211ULL;
+    return hash ^ (hash >> 29);
+}
+
+// Open-addressing index from a name to its position in a names vector that the
+// caller keeps (so a name is stored once). Slots hold the ID and the top bits of
+// the hash, so most probes that miss never touch the name itself.
+class NameIndex {
+    vector<uint64_t> slots;   // (hash tag << 32) | (id + 1); 0 is empty
+    size_t mask = 0;
+    size_t count = 0;
+
+    void grow();
+
+public:
+    void reserve(size_t names);
+    template <class Names> int find(string_view name, uint64_t hash, const Names& names) const;
+    void insert(int id, uint64_t hash);  // name must not be present yet
+    void clear();
+};
+
+// Gives every location name a dense integer ID (0, 1, 2, ... in order of first
+// use) and collects roads until Graph::freeze() packs them into CSR arrays.
+class GraphBuilder {
+public:
+    vector<string> names;           // location name by ID
+    NameIndex ids;
+    vector<BuilderEdge> edges;      // roads added since the last freeze
+
+    int intern(string_view name);
+    int intern(string_view name, uint64_t hash);  // hash is nameHash(name)
+    int find(const string& name);   // -1 for a location never added
+    void addEdge(const string& u, const string& v, int weight);
+    void addEdge(int u, int v, int weight);
+};
+
+// Min-heap of (distance, node) used by the searches below
+typedef priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> DistanceHeap;
+
+// Priority queues for Graph::shortestPathWith<Queue>() and the other route
+// searches. Dijkstra only ever pushes keys at or above the last one popped, and
+// never more than the largest road weight above it, which the two integer queues
+// rely on. All of them take prepare(maxWeight) before a search, then push(key,
+// node), empty(), topKey() (the smallest key, without removing it) and pop().
+
+// The general-purpose binary heap, as a baseline
+class BinaryHeapQueue {
+    DistanceHeap heap;
+
+public:
+    void prepare(int maxWeight);
+    bool empty() const { return heap.empty(); }
+    void push(int key, int node) { heap.push({key, node}); }
+    int topKey() const { return heap.top().first; }
+    pair<int, int> pop();
+};
+
+// Radix heap: bucket i holds keys whose highest bit differing from the last
+// key popped is bit i - 1. A pop that finds bucket 0 empty spreads the first
+// non-empty bucket over the lower ones; each entry moves down at most 32 times.
+class RadixHeap {
+    vector<pair<int, int>> buckets[33];
+    int last = 0;
+    size_t count = 0;
+
+    int bucketOf(int key) const;
+    void refill();
+
+public:
+    void prepare(int maxWeight);
+    bool empty() const { return count == 0; }
+    void push(int key, int node);
+    int topKey();
+    pair<int, int> pop();
+};
+
+// Dial's buckets: a ring of maxWeight + 1 node lists indexed by key, so every
+// key waiting is in its own slot. Best when road weights are small integers.
+class DialQueue {
+    vector<vector<int>> ring;
+    int cursor = 0;         // slot of currentKey
+    int currentKey = 0;
+    size_t count = 0;
+
+    void advance();
+
+public:
+    void prepare(int maxWeight);
+    bool empty() const { return count == 0; }
+    void push(int key, int node);
+    int topKey();
+    pair<int, int> pop();
+};
+
+// The queue every route search uses; swap it here to try another
+typedef RadixHeap RouteQueue;
+
+// Contraction hierarchy over the road network. Locations are contracted one at
+// a time, least important first, and shortcuts keep the distances between the
+// ones left. Every road and shortcut is then stored once, at its lower-ranked
+// end, so a route query is two small searches that only climb in rank, one from
+// each end, meeting at the top. A shortcut remembers the location it skips
+// (middle), which is how the full route is unpacked afterwards.
+class ContractionHierarchy {
+    vector<int> rank;
+    vector<int> upOffsets;
+    vector<int> upTargets;
+    vector<int> upWeights;
+    vector<int> upMiddles;      // -1 for a real road
+
+    // Query scratch, one set per search direction
+    vector<int> distance[2];
+    vector<int> parentNode[2];
+    vector<int> parentEdge[2];
+    vector<int> touched[2];
+
+    int findUpEdge(int low, int high);
+    void unpackEdge(int from, int to, int middle, vector<int>& path);
+
+public:
+    unsigned long long graphVersion = 0;  // Graph::version it was built from
+    bool built = false;
+    long long shortcuts = 0;
+    double buildMs = 0;
+
+    void build(Graph& graph);
+    int query(int start, int end, vector<int>* path, long long* settled);  // INT_MAX when unreachable
+    size_t memoryBytes();
+};
+
+// A road or shortcut in the graph that is still being contracted
+struct ContractionEdge {
+    int to;
+    int weight;
+    int middle;     // location a shortcut skips, -1 for a real road
+};
+
+// Working state while a hierarchy is built; thrown away afterwards
+class HierarchyContractor {
+    vector<vector<ContractionEdge>> adjacency;   // roads between locations not yet contracted
+    vector<int> deletedNeighbors;
+    vector<int> witnessDistance;
+    vector<int> witnessTouched;
+    vector<char> witnessTarget;     // neighbours the current witness search still has to reach
+    DistanceHeap witnessHeap;
+
+    void addEdge(int u, int v, int weight, int middle);
+    void removeEdge(int u, int v);
+    void witnessSearch(int source, int skip, int limit, int targets, int maxSettled);
+    int findShortcuts(int node, vector<BuilderEdge>* shortcuts, int maxSettled);
+
+public:
+    HierarchyContractor(const vector<int>& offsets, const vector<int>& targets, const WeightReader& weights);
+    int priority(int node);
+    // Removes node from the graph; its remaining roads become its upward edges
+    void contract(int node, vector<ContractionEdge>& upward, long long& shortcutCount);
+};
+
+// A new travel time for an existing road, by location ID
+struct RoadUpdate {
+    int from;
+    int to;
+    int weight;
+};
+
+// Open-addressing index from a road (either direction) to its two CSR arcs, so
+// a congestion update finds the weights to change without scanning adjacency
+class RoadIndex {
+    struct Slot {
+        uint64_t key;   // (low end + 1) << 32 | (high end + 1); 0 is empty
+        int forward;    // arc low -> high
+        int backward;   // arc high -> low
+    };
+    vector<Slot> slots;
+    size_t mask = 0;
+
+    static uint64_t roadKey(int u, int v);
+
+public:
+    bool built = false;
+
+    void build(const vector<int>& offsets, const vector<int>& targets);
+    bool find(int u, int v, int& forward, int& backward) const;
+    void clear();
+    size_t memoryBytes();
+};
+
+// Road weights in two copies, so congestion updates can land while routes are
+// being searched. A search holds a WeightReader for its duration and reads the
+// copy that was live when it started. An update batch is written into the other
+// copy, once the searches still on it have finished, and published with one
+// atomic store: a search sees all of a batch or none of it.
+class RoadWeights {
+    friend class WeightReader;
+
+    vector<int> copies[2];
+    atomic<int> live;
+    atomic<int> readers[2];
+    mutex updateLock;
+    vector<int> lastArcs;           // arcs the spare copy is still missing
+    bool spareCurrent = false;      // spare copy equals live apart from lastArcs
+
+public:
+    RoadWeights();
+    // For code that changes the road structure; no searches or updates may be running
+    vector<int>& current();
+    void replace(vector<int>& weights);
+    // arcs[2 * i] and arcs[2 * i + 1] are the two arcs of batch[i]
+    void publish(const vector<RoadUpdate>& batch, const vector<int>& arcs);
+    size_t memoryBytes();
+};
+
+class WeightReader {
+    RoadWeights& table;
+    int side;
+    const int* data;
+
+public:
+    explicit WeightReader(RoadWeights& weights);
+    ~WeightReader();
+    int operator[](int arc) const { return data[arc]; }
+};
+
+// Per-thread working arrays for searches that may run side by side on one graph
+struct SearchScratch {
+    vector<int> distance;
+    vector<int> parent;
+    vector<int> touched;
+    vector<char> isStation;
+    DistanceHeap heap;
+};
+
+// Nearest station for every location, from one search seeded at all stations
+struct StationCoverage {
+    vector<int> station;        // closest station, -1 when none reaches it
+    vector<int> distance;
+    vector<int> parent;         // next location on the way back to that station
+    unsigned long long graphVersion = 0;
+    bool built = false;
+};
+
+// Precomputed distances from a few landmark locations. For any location v and
+// destination t, |d(L, t) - d(L, v)| never exceeds the real distance from v to
+// t (roads run both ways), so the largest such gap over the landmarks is a lower
+// bound that steers A* towards the destination.
+struct LandmarkTable {
+    vector<int> landmarks;
+    vector<int> distances;      // distances[v * landmarks.size() + i] = d(landmark i, v)
+    unsigned long long graphVersion = 0;
+    bool built = false;
+    double buildMs = 0;
+};
+
+// How a route query searches; the indexed ones fall back to Dijkstra while
+// their index is missing or older than the roads
+enum RouteStrategy {
+    ROUTE_AUTO,             // hierarchy, else landmarks, else Dijkstra
+    ROUTE_DIJKSTRA,
+    ROUTE_BIDIRECTIONAL,
+    ROUTE_LANDMARKS,        // A* with landmark lower bounds (ALT)
+    ROUTE_HIERARCHY
+};
+const char* routeStrategyName(RouteStrategy strategy);
+
+struct RouteStats {
+    RouteStrategy used = ROUTE_DIJKSTRA;
+    long long settled = 0;      // locations taken off the heap for good
+    double microseconds = 0;
+    bool cached = false;        // answered by the route cache without searching
+};
+
+// Recent route answers, for dispatchers asking the same routes again. Holds an
+// LRU list of (origin, destination) -> (distance, path), and full shortest-path
+// trees for origins that keep missing (hospitals, stations), which answer every
+// destination from there. Everything is dropped when the graph version moves.
+// Not thread-safe; Graph::cachedRoute() is its only user.
+class RouteCache {
+    struct Entry {
+        uint64_t key;           // origin << 32 | destination
+        int distance;
+        vector<int> path;
+    };
+    struct Tree {
+        int origin;
+        vector<int> distance;
+        vector<int> parent;
+    };
+    list<Entry> entries;        // most recently used first
+    unordered_map<uint64_t, list<Entry>::iterator> index;
+    list<Tree> trees;           // most recently used first
+    unordered_map<int, int> originMisses;
+
+    static uint64_t routeKey(int start, int end) { return ((uint64_t)(uint32_t)start << 32) | (uint32_t)end; }
+
+public:
+    size_t capacity = 4096;     // routes
+    size_t treeCapacity = 4;
+    int hotAfter = 3;           // misses from one origin before it gets a tree
+    unsigned long long graphVersion = 0;
+    long long hits = 0, treeHits = 0, misses = 0, invalidations = 0;
+
+    void invalidate(unsigned long long version);
+    bool find(int start, int end, int& distance, vector<int>* path, bool counted = true);
+    void insert(int start, int end, int distance, const vector<int>& path);
+    bool wantsTree(int origin);  // counts a miss from origin
+    void insertTree(int origin, vector<int>& distance, vector<int>& parent);
+    double hitRate();
+    size_t routeCount() { return entries.size(); }
+    size_t treeCount() { return trees.size(); }
+    size_t memoryBytes();
+};
+
+// Outcome of dispatching the nearest station to one incident
+struct DispatchResult {
+    int incident;
+    int station = -1;           // -1 when no station can reach the incident
+    int distance = INT_MAX;
+    vector<int> route;          // station first, incident last
+};
+
+// Road network in compressed sparse row form: the roads leaving location u are
+// targets/weights[offsets[u] .. offsets[u + 1]). Searches work on location IDs
+// with flat distance/parent/visited arrays; names are only looked up at the edges
+// of the API. addEdge() goes through the builder and is applied by the next
+// freeze(), which every query calls first.
 class Graph {
-    unordered_map<string, vector<pair<string, int>>> adjList;
+    friend class ContractionHierarchy;
+
+    GraphBuilder builder;
+    vector<int> offsets;
+    vector<int> targets;
+    RoadWeights weights;
+    RoadIndex roads;                 // built on the first weight update
+
+    // Scratch space for searches, sized to the node count by freeze()
+    vector<int> distance;
+    vector<int> parent;
+    vector<char> visited;
+    vector<int> touched;             // entries of distance/parent that shortestPathWith() wrote
+
+    ContractionHierarchy hierarchy;  // see buildRouteIndex()
+    vector<int> stations;            // locations units are dispatched from
+    StationCoverage coverage;        // see buildStationCoverage()
+    LandmarkTable landmarks;         // see buildLandmarks()
+    SearchScratch routeScratch[2];   // forward and backward sides of the searches below
+    RouteQueue routeQueues[2];       // the route searches' queues, kept for their buffers
+    RouteCache routeCache;           // see cachedRoute()
+    atomic<int> maxRoadWeight{0};    // at least the largest weight, for the integer queues
+
+    int landmarkBound(int node, int end);
+    void distancesFrom(int source, vector<int>& dist, vector<int>* parents = nullptr);
+
+public:
+    atomic<unsigned long long> version{0};  // bumped whenever the roads or their weights change
+
+    void addEdge(string u, string v, int weight);
+    void addEdge(int u, int v, int weight);
+    int addLocation(const string& name);
+    void freeze();
+
+    int nodeCount();
+    long long edgeCount();          // directed arcs, so each road counts twice
+    size_t memoryBytes();
+    int findLocation(const string& name);
+    const string& locationName(int id);
+
+    void displayGraph();
+    void bfs(string start);
+    void dfs(string start);
+    void ambulanceRouteOptimization(string start, string end);
+
+    // Road network files, see the "Road network files" section below
+    bool loadEdgeList(const string& path, int threads);
+    bool saveCache(const string& path, const string& sourcePath);
+    bool loadCache(const string& path, const string& sourcePath);
+
+    // Quiet versions of the above for benchmarks and other callers
+    void bfsOrder(int start, vector<int>& order);
+    void dfsOrder(int start, vector<int>& order);
+    int shortestPath(int start, int end, vector<int>* path, long long* settled = nullptr);  // INT_MAX when unreachable
+    template <class Queue> int shortestPathWith(Queue& queue, int start, int end, vector<int>* path, long long* settled);
+    template <class Queue> int bidirectionalPathWith(Queue (&queues)[2], int start, int end, vector<int>* path, long long* settled);
+    template <class Queue> int landmarkPathWith(Queue& queue, int start, int end, vector<int>* path, long long* settled);
+    int roadWeight(int from, int to);  // shortest direct road, INT_MAX when there is none
+
+    // Optional contraction hierarchy; routes use it while the roads are unchanged
+    void buildRouteIndex();
+    bool hasRouteIndex();
+    ContractionHierarchy& routeIndex() { return hierarchy; }
+    int route(int start, int end, vector<int>* path);  // hierarchy when current, Dijkstra otherwise
+
+    // Selectable search strategies, each reporting the work it did
+    RouteStrategy routeStrategy = ROUTE_AUTO;   // used by ambulanceRouteOptimization()
+    void buildLandmarks(int count);
+    bool hasLandmarks();
+    LandmarkTable& landmarkTable() { return landmarks; }
+    int findRoute(int start, int end, RouteStrategy strategy, vector<int>* path, RouteStats* stats);
+
+    // findRoute() with routeStrategy behind the route cache
+    int cachedRoute(int start, int end, vector<int>* path, RouteStats* stats);
+    RouteCache& cache() { return routeCache; }
+    void displayCacheStats();
+
+    // Congestion: change travel times of existing roads in place. Searches may
+    // run alongside one updating thread and see each batch whole or not at all.
+    void buildRoadIndex();
+    bool updateRoad(const string& u, const string& v, int weight);
+    int updateRoads(const vector<RoadUpdate>& batch);  // roads actually found and updated
+
+    // Dispatch: finding the station closest to an incident
+    bool addStation(const string& name);
+    const vector<int>& stationList();
+    void dispatchUnit(string incident);
+    DispatchResult nearestStation(const vector<int>& from, int incident, SearchScratch& scratch);
+    void dispatchIncidents(const vector<int>& from, const vector<int>& incidents, vector<DispatchResult>& results, int threads);
+    // Multi-source search from all registered stations, then one lookup per incident
+    void buildStationCoverage();
+    bool hasStationCoverage();
+    DispatchResult coveredStation(int incident);
+};
+
+// Read-only view of a whole file: memory-mapped on POSIX systems, read into
+// memory in one go elsewhere
+class MappedFile {
+    const char* data;
+    size_t size;
+#if defined(_WIN32)
+    vector<char> contents;
+#else
+    void* mapping;
+#endif
+
+public:
+    MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+    bool open(const string& path);
+    const char* Data() { return data; }
+    size_t Size() { return size; }
+};
+
+// Binary cache of a built graph: this header, then offsets (nodes + 1 ints),
+// targets and weights (arcs ints each) and the location names, each followed
+// by a '\0'. sourceBytes/sourceModified tie it to the edge list it was built from.
+struct GraphCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sourceBytes;
+    int64_t sourceModified;
+    uint64_t nodes;
+    uint64_t arcs;
+    uint64_t nameBytes;
+    uint64_t checksum;      // cacheChecksum() of everything after the header
+};
+
+class CrowdControl {
+    Stack crowdStack;
+    queue<string> crowdQueue;
+
+public:
+    void addPersonToStack(string name);
+    void removePersonFromStack();
+    void emptyCrowdStack();
+    void displayCrowdStack();
+    void addPersonToQueue(string name);
+    void removePersonFromQueue();
+    void emptyCrowdQueue();
+    void displayCrowdQueue();
+};
+
+// Stack methods
+void Stack::push(string name) {
+    stack.push_back(name);
+}
+
+void Stack::pop() {
+    if (!stack.empty()) {
+        stack.pop_back();
+    }
+}
+
+string Stack::top() {
+    if (!stack.empty()) {
+        return stack.back();
+    }
+    return "";
+}
+
+bool Stack::empty() {
+    return stack.empty();
+}
+
+void Stack::clear() {
+    stack.clear();
+}
+
+void Stack::display() {
+    if (stack.empty()) {
+        cout << "Stack is empty." << endl;
+    } else {
+        cout << "Stack contents: ";
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            cout << *it << " ";
+        }
+        cout << endl;
+    }
+}
+
+// NameIndex methods
+void NameIndex::reserve(size_t names) {
+    size_t wanted = 16;
+    while (wanted < names * 2) wanted <<= 1;
+    if (wanted <= slots.size()) return;
+    vector<uint64_t> old;
+    old.swap(slots);
+    slots.assign(wanted, 0);
+    mask = wanted - 1;
+    for (uint64_t slot : old) {
+        if (slot == 0) continue;
+        size_t at = (size_t)(slot >> 32) & mask;
+        while (slots[at] != 0) at = (at + 1) & mask;
+        slots[at] = slot;
+    }
+}
+
+void NameIndex::grow() {
+    reserve(slots.empty() ? 8 : slots.size());
+}
+
+template <class Names>
+int NameIndex::find(string_view name, uint64_t hash, const Names& names) const {
+    if (slots.empty()) return -1;
+    uint32_t tag = (uint32_t)(hash >> 32);
+    for (size_t at = tag & mask; slots[at] != 0; at = (at + 1) & mask) {
+        if ((uint32_t)(slots[at] >> 32) != tag) continue;
+        int id = (int)(uint32_t)slots[at] - 1;
+        if (string_view(names[id]) == name) return id;
+    }
+    return -1;
+}
+
+void NameIndex::insert(int id, uint64_t hash) {
+    if ((count + 1) * 2 > slots.size()) grow(); // at most half full
+    uint32_t tag = (uint32_t)(hash >> 32);
+    size_t at = tag & mask;
+    while (slots[at] != 0) at = (at + 1) & mask;
+    slots[at] = ((uint64_t)tag << 32) | (uint32_t)(id + 1);
+    count++;
+}
+
+void NameIndex::clear() {
+    slots.clear();
+    mask = count = 0;
+}
+
+// GraphBuilder methods
+int GraphBuilder::intern(string_view name) {
+    return intern(name, nameHash(name));
+}
+
+int GraphBuilder::intern(string_view name, uint64_t hash) {
+    int id = ids.find(name, hash, names);
+    if (id >= 0) return id;
+    id = (int)names.size();
+    names.emplace_back(name);
+    ids.insert(id, hash);
+    return id;
+}
+
+int GraphBuilder::find(const string& name) {
+    return ids.find(name, nameHash(name), names);
+}
+
+void GraphBuilder::addEdge(const string& u, const string& v, int weight) {
+    int from = intern(u);
+    int to = intern(v);
+    addEdge(from, to, weight);
+}
+
+void GraphBuilder::addEdge(int u, int v, int weight) {
+    edges.push_back({u, v, weight});
+}
+
+// Route queue methods
+void BinaryHeapQueue::prepare(int) {
+    while (!heap.empty()) heap.pop();
+}
+
+pair<int, int> BinaryHeapQueue::pop() {
+    pair<int, int> top = heap.top();
+    heap.pop();
+    return top;
+}
+
+int RadixHeap::bucketOf(int key) const {
+    unsigned differ = (unsigned)key ^ (unsigned)last;
+    if (differ == 0) return 0;
+#if defined(__GNUC__)
+    return 32 - __builtin_clz(differ);
+#else
+    int bit = 0;
+    while (differ != 0) {
+        differ >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+void RadixHeap::prepare(int) {
+    for (auto& bucket : buckets) bucket.clear();
+    last = 0;
+    count = 0;
+}
+
+void RadixHeap::push(int key, int node) {
+    buckets[bucketOf(key)].push_back({key, node});
+    count++;
+}
+
+// Spreads the first non-empty bucket when bucket 0 has run out
+void RadixHeap::refill() {
+    if (!buckets[0].empty()) return;
+    int i = 1;
+    while (buckets[i].empty()) i++;
+    last = buckets[i][0].first;
+    for (const auto& entry : buckets[i]) last = min(last, entry.first);
+    for (const auto& entry : buckets[i]) buckets[bucketOf(entry.first)].push_back(entry);
+    buckets[i].clear();
+}
+
+int RadixHeap::topKey() {
+    refill();
+    return last;
+}
+
+pair<int, int> RadixHeap::pop() {
+    refill();
+    pair<int, int> top = buckets[0].back();
+    buckets[0].pop_back();
+    count--;
+    return top;
+}
+
+void DialQueue::prepare(int maxWeight) {
+    if ((int)ring.size() < maxWeight + 1) ring.resize(maxWeight + 1);
+    for (auto& slot : ring) slot.clear();
+    cursor = currentKey = 0;
+    count = 0;
+}
+
+void DialQueue::push(int key, int node) {
+    ring[(cursor + (key - currentKey)) % ring.size()].push_back(node);
+    count++;
+}
+
+// Moves the cursor on to the first slot still holding a node
+void DialQueue::advance() {
+    while (ring[cursor].empty()) {
+        cursor = cursor + 1 == (int)ring.size() ? 0 : cursor + 1;
+        currentKey++;
+    }
+}
+
+int DialQueue::topKey() {
+    advance();
+    return currentKey;
+}
+
+pair<int, int> DialQueue::pop() {
+    advance();
+    int node = ring[cursor].back();
+    ring[cursor].pop_back();
+    count--;
+    return {currentKey, node};
+}
+
+// Graph methods
+void Graph::addEdge(string u, string v, int weight) {
+    builder.addEdge(u, v, weight);
+}
+
+void Graph::addEdge(int u, int v, int weight) {
+    builder.addEdge(u, v, weight);
+}
+
+int Graph::addLocation(const string& name) {
+    return builder.intern(name);
+}
+
+// Merges the pending roads into the CSR arrays. Each location keeps its existing
+// roads first and then the new ones in the order they were added, as before.
+// Adding a road that already exists sets its weight rather than duplicating it.
+void Graph::freeze() {
+    int oldNodes = offsets.empty() ? 0 : (int)offsets.size() - 1;
+    int nodes = (int)builder.names.size();
+    if (builder.edges.empty() && nodes == oldNodes) return;
+
+    vector<int> newOffsets(nodes + 1, 0);
+    for (int u = 0; u < oldNodes; u++) newOffsets[u + 1] = offsets[u + 1] - offsets[u];
+    for (const BuilderEdge& edge : builder.edges) {
+        newOffsets[edge.from + 1]++;
+        newOffsets[edge.to + 1]++;
+    }
+    for (int u = 0; u < nodes; u++) newOffsets[u + 1] += newOffsets[u];
+
+    vector<int> newTargets(newOffsets[nodes]);
+    vector<int> newWeights(newOffsets[nodes]);
+    vector<int> fill(newOffsets.begin(), newOffsets.end() - 1);
+    vector<int>& oldWeights = weights.current();
+    for (int u = 0; u < oldNodes; u++) {
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            newTargets[fill[u]] = targets[e];
+            newWeights[fill[u]++] = oldWeights[e];
+        }
+    }
+    for (const BuilderEdge& edge : builder.edges) {
+        newTargets[fill[edge.from]] = edge.to;
+        newWeights[fill[edge.from]++] = edge.weight;
+        if (edge.to == edge.from) continue;
+        newTargets[fill[edge.to]] = edge.from;
+        newWeights[fill[edge.to]++] = edge.weight;
+    }
+
+    // drop repeated roads in place, the later weight winning at the earlier slot
+    vector<int> slotOf(nodes, -1);
+    int kept = 0;
+    for (int u = 0; u < nodes; u++) {
+        int first = kept;
+        for (int e = newOffsets[u]; e < fill[u]; e++) {
+            int v = newTargets[e];
+            if (slotOf[v] >= first) {
+                newWeights[slotOf[v]] = newWeights[e];
+                continue;
+            }
+            slotOf[v] = kept;
+            newTargets[kept] = v;
+            newWeights[kept++] = newWeights[e];
+        }
+        newOffsets[u] = first;
+    }
+    newOffsets[nodes] = kept;
+    newTargets.resize(kept);
+    newWeights.resize(kept);
+
+    int largest = 0;
+    for (int w : newWeights) largest = max(largest, w);
+    maxRoadWeight = largest;
+    offsets.swap(newOffsets);
+    targets.swap(newTargets);
+    weights.replace(newWeights);
+    roads.clear();
+    vector<BuilderEdge>().swap(builder.edges);
+    version++;
+    distance.assign(nodes, INT_MAX);
+    parent.assign(nodes, -1);
+    visited.assign(nodes, 0);
+}
+
+int Graph::nodeCount() {
+    return (int)builder.names.size();
+}
+
+long long Graph::edgeCount() {
+    freeze();
+    return (long long)targets.size();
+}
+
+size_t Graph::memoryBytes() {
+    freeze();
+    return (offsets.capacity() + targets.capacity() + distance.capacity() + parent.capacity()) * sizeof(int)
+         + weights.memoryBytes() + roads.memoryBytes() + visited.capacity();
+}
+
+int Graph::findLocation(const string& name) {
+    return builder.find(name);
+}
+
+const string& Graph::locationName(int id) {
+    return builder.names[id];
+}
+
+void Graph::displayGraph() {
+    freeze();
+    WeightReader weight(weights);
+    cout << "Graph Representation:" << endl;
+    for (int u = 0; u < nodeCount(); u++) {
+        cout << builder.names[u] << " -> ";
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            cout << "(" << builder.names[targets[e]] << ", " << weight[e] << ") ";
+        }
+        cout << endl;
+    }
+}
+
+void Graph::bfsOrder(int start, vector<int>& order) {
+    freeze();
+    order.clear();
+    order.push_back(start);
+    visited[start] = 1;
+    // order doubles as the queue: everything past head is still waiting
+    for (size_t head = 0; head < order.size(); head++) {
+        int node = order[head];
+        for (int e = offsets[node]; e < offsets[node + 1]; e++) {
+            if (!visited[targets[e]]) {
+                visited[targets[e]] = 1;
+                order.push_back(targets[e]);
+            }
+        }
+    }
+    for (int node : order) visited[node] = 0;
+}
+
+// Iterative, with an explicit stack of (node, next road to try), so deep road
+// networks cannot overflow the call stack; visits nodes in the same order as a
+// recursive depth-first search would
+void Graph::dfsOrder(int start, vector<int>& order) {
+    freeze();
+    order.clear();
+    vector<pair<int, int>> stack;
+    visited[start] = 1;
+    order.push_back(start);
+    stack.push_back({start, offsets[start]});
+    while (!stack.empty()) {
+        pair<int, int>& top = stack.back();
+        if (top.second == offsets[top.first + 1]) {
+            stack.pop_back();
+            continue;
+        }
+        int next = targets[top.second++];
+        if (!visited[next]) {
+            visited[next] = 1;
+            order.push_back(next);
+            stack.push_back({next, offsets[next]});
+        }
+    }
+    for (int node : order) visited[node] = 0;
+}
+
+void Graph::bfs(string start) {
+    int id = findLocation(start);
+    if (id < 0) {
+        cout << "Unknown location: " << start << endl;
+        return;
+    }
+    vector<int> order;
+    bfsOrder(id, order);
+    cout << "BFS Traversal starting from " << start << ": ";
+    for (int node : order) cout << builder.names[node] << " ";
+    cout << endl;
+}
+
+void Graph::dfs(string start) {
+    int id = findLocation(start);
+    if (id < 0) {
+        cout << "Unknown location: " << start << endl;
+        return;
+    }
+    vector<int> order;
+    dfsOrder(id, order);
+    cout << "DFS Traversal starting from " << start << ": ";
+    for (int node : order) cout << builder.names[node] << " ";
+    cout << endl;
+}
+
+// Dijkstra from start, stopping once end is taken off the heap. path, when
+// given, receives the route from start to end.
+int Graph::shortestPath(int start, int end, vector<int>* path, long long* settled) {
+    return shortestPathWith(routeQueues[0], start, end, path, settled);
+}
+
+template <class Queue>
+int Graph::shortestPathWith(Queue& queue, int start, int end, vector<int>* path, long long* settled) {
+    freeze();
+    WeightReader weight(weights);
+    queue.prepare(maxRoadWeight.load());   // read after the weights, so it covers them
+    distance[start] = 0;
+    touched.push_back(start);
+    queue.push(0, start);
+
+    while (!queue.empty()) {
+        pair<int, int> top = queue.pop();
+        int current = top.second;
+        int currentDist = top.first;
+        // a location is pushed again each time its distance drops; skip the outdated entries
+        if (currentDist > distance[current]) continue;
+        if (settled != nullptr) (*settled)++;
+
+        if (current == end) break;
+
+        for (int e = offsets[current]; e < offsets[current + 1]; e++) {
+            int neighbor = targets[e];
+            int newDist = currentDist + weight[e];
+            if (newDist < distance[neighbor]) {
+                if (distance[neighbor] == INT_MAX) touched.push_back(neighbor);
+                distance[neighbor] = newDist;
+                queue.push(newDist, neighbor);
+                parent[neighbor] = current;
+            }
+        }
+    }
+
+    int result = distance[end];
+    if (path != nullptr) {
+        path->clear();
+        if (result != INT_MAX) {
+            for (int node = end; node != start; node = parent[node]) path->push_back(node);
+            path->push_back(start);
+            reverse(path->begin(), path->end());
+        }
+    }
+    // only the entries this search wrote need resetting for the next one
+    for (int node : touched) {
+        distance[node] = INT_MAX;
+        parent[node] = -1;
+    }
+    touched.clear();   // keeps its capacity for the next search
+    return result;
+}
+
+void Graph::ambulanceRouteOptimization(string start, string end) {
+    int from = findLocation(start);
+    int to = findLocation(end);
+    vector<int> route;
+    RouteStats stats;
+    int result = (from < 0 || to < 0) ? INT_MAX : cachedRoute(from, to, &route, &stats);
+
+    if (result == INT_MAX) {
+        cout << "No route found from " << start << " to " << end << endl;
+    } else {
+        cout << "Optimized Route (Ambulance): ";
+        for (size_t i = 0; i < route.size(); i++) {
+            if (i > 0) cout << " -> ";
+            cout << builder.names[route[i]];
+        }
+        cout << " | Distance: " << result << endl;
+        if (stats.cached) {
+            cout << "(from the route cache, " << stats.microseconds << " us)" << endl;
+        } else {
+            cout << "(" << routeStrategyName(stats.used) << " search, " << stats.settled << " locations settled, "
+                 << stats.microseconds << " us)" << endl;
+        }
+    }
+}
+
+// Road network files
+MappedFile::MappedFile() {
+    data = nullptr;
+    size = 0;
+#if !defined(_WIN32)
+    mapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (mapping != nullptr) munmap(mapping, size);
+#endif
+}
+
+bool MappedFile::open(const string& path) {
+#if defined(_WIN32)
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return false;
+    contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    size = (size_t)info.st_size;
+    if (size > 0) {
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) mapping = nullptr;
+        else madvise(mapping, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    if (size > 0 && mapping == nullptr) return false;
+    data = (const char*)mapping;
+    return true;
+#endif
+}
+
+// What one loader thread makes of its slice of the edge list. Names get IDs
+// local to the chunk (in order of first use) and are mapped to graph IDs once
+// every chunk is done, so the threads never share a hash table.
+struct EdgeChunk {
+    const char* begin;
+    const char* end;
+    NameIndex localIds;
+    vector<string_view> localNames;   // point into the mapped file
+    vector<uint64_t> localHashes;     // nameHash() of each, reused when merging
+    vector<BuilderEdge> edges;
+    long long badLines = 0;
+};
+
+string_view trimField(const char* begin, const char* end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '"')) begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '"')) end--;
+    return string_view(begin, end - begin);
+}
+
+int chunkLocalId(EdgeChunk& chunk, string_view name) {
+    uint64_t hash = nameHash(name);
+    int id = chunk.localIds.find(name, hash, chunk.localNames);
+    if (id >= 0) return id;
+    id = (int)chunk.localNames.size();
+    chunk.localIds.insert(id, hash);
+    chunk.localNames.push_back(name);
+    chunk.localHashes.push_back(hash);
+    return id;
+}
+
+// Lines are "from<sep>to<sep>weight", where sep is the file's separator
+// (',' or tab; runs of spaces when the file has neither). Blank lines and
+// lines starting with '#' are skipped; anything else that does not parse is
+// counted as bad.
+void parseEdgeChunk(EdgeChunk& chunk, char separator) {
+    chunk.edges.reserve((chunk.end - chunk.begin) / 24); // typical line length, avoids most regrowth
+    const char* line = chunk.begin;
+    while (line < chunk.end) {
+        const char* lineEnd = (const char*)memchr(line, '\n', chunk.end - line);
+        if (lineEnd == nullptr) lineEnd = chunk.end;
+        const char* fields[3];
+        const char* fieldEnds[3];
+        int count = 0;
+        const char* at = line;
+        while (count < 3 && at < lineEnd) {
+            if (separator == ' ') {
+                while (at < lineEnd && (*at == ' ' || *at == '\t')) at++;
+                if (at == lineEnd || *at == '\r') break;
+            }
+            fields[count] = at;
+            while (at < lineEnd && (separator == ' ' ? (*at != ' ' && *at != '\t') : *at != separator)) at++;
+            fieldEnds[count++] = at;
+            if (at < lineEnd) at++;
+        }
+        string_view first = count > 0 ? trimField(fields[0], fieldEnds[0]) : string_view();
+        if (first.empty() || first[0] == '#') {
+            line = lineEnd + 1;
+            continue;
+        }
+        long long weight = -1;
+        if (count == 3 && at >= lineEnd) {
+            string_view text = trimField(fields[2], fieldEnds[2]);
+            weight = text.empty() ? -1 : 0;
+            for (char digit : text) {
+                if (digit < '0' || digit > '9' || weight > INT_MAX) {
+                    weight = -1;
+                    break;
+                }
+                weight = weight * 10 + (digit - '0');
+            }
+            if (weight > INT_MAX) weight = -1;
+        }
+        string_view second = count > 1 ? trimField(fields[1], fieldEnds[1]) : string_view();
+        if (weight < 0 || second.empty()) {
+            chunk.badLines++;
+        } else {
+            int from = chunkLocalId(chunk, first);
+            int to = chunkLocalId(chunk, second);
+            chunk.edges.push_back({from, to, (int)weight});
+        }
+        line = lineEnd + 1;
+    }
+}
+
+// Parses the whole file with `threads` threads, one slice each (cut at line
+// ends), then adds the roads in file order, so the result is the same as
+// calling addEdge() line by line. A header line such as "from,to,weight" is
+// skipped as a bad line would be, but not counted.
+bool Graph::loadEdgeList(const string& path, int threads) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cout << "Error: Unable to open " << path << endl;
+        return false;
+    }
+    const char* data = file.Data();
+    size_t size = file.Size();
+    if (threads < 1) threads = 1;
+    if ((size_t)threads > size / 4096 + 1) threads = (int)(size / 4096 + 1); // small files stay on one thread
+
+    // separator from the first line that is not a comment
+    char separator = ' ';
+    const char* firstLine = data;
+    while (firstLine < data + size && *firstLine == '#') {
+        const char* next = (const char*)memchr(firstLine, '\n', data + size - firstLine);
+        firstLine = next == nullptr ? data + size : next + 1;
+    }
+    for (const char* at = firstLine; at < data + size && *at != '\n'; at++) {
+        if (*at == ',' || *at == '\t') {
+            separator = *at;
+            break;
+        }
+    }
+
+    vector<EdgeChunk> chunks(threads);
+    for (int t = 0; t < threads; t++) {
+        size_t begin = size * t / threads;
+        size_t end = size * (t + 1) / threads;
+        while (begin > 0 && begin < size && data[begin - 1] != '\n') begin++;
+        while (end < size && end > 0 && data[end - 1] != '\n') end++;
+        chunks[t].begin = data + min(begin, size);
+        chunks[t].end = data + max(min(end, size), min(begin, size));
+    }
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) workers.push_back(thread(parseEdgeChunk, ref(chunks[t]), separator));
+    parseEdgeChunk(chunks[0], separator);
+    for (thread& worker : workers) worker.join();
+
+    // a header line shows up as the first line failing to parse
+    long long badLines = 0;
+    for (EdgeChunk& chunk : chunks) badLines += chunk.badLines;
+    if (chunks[0].badLines > 0) {
+        EdgeChunk header;
+        header.begin = firstLine;
+        const char* lineEnd = (const char*)memchr(firstLine, '\n', data + size - firstLine);
+        header.end = lineEnd == nullptr ? data + size : lineEnd;
+        parseEdgeChunk(header, separator);
+        badLines -= header.badLines;
+    }
+
+    // chunk IDs to graph IDs, chunk by chunk in file order
+    vector<vector<int>> remap(threads);
+    size_t totalEdges = 0;
+    for (int t = 0; t < threads; t++) {
+        remap[t].resize(chunks[t].localNames.size());
+        builder.names.reserve(builder.names.size() + chunks[t].localNames.size());
+        builder.ids.reserve(builder.names.size() + chunks[t].localNames.size());
+        for (size_t i = 0; i < chunks[t].localNames.size(); i++) {
+            remap[t][i] = builder.intern(chunks[t].localNames[i], chunks[t].localHashes[i]);
+        }
+        totalEdges += chunks[t].edges.size();
+    }
+    size_t firstEdge = builder.edges.size();
+    builder.edges.resize(firstEdge + totalEdges);
+    workers.clear();
+    auto translate = [&](int t, size_t at) {
+        for (const BuilderEdge& edge : chunks[t].edges) {
+            builder.edges[at++] = {remap[t][edge.from], remap[t][edge.to], edge.weight};
+        }
+        vector<BuilderEdge>().swap(chunks[t].edges);
+    };
+    size_t at = firstEdge;
+    for (int t = 0; t < threads; t++) {
+        if (t > 0) workers.push_back(thread(translate, t, at));
+        at += chunks[t].edges.size();
+    }
+    translate(0, firstEdge);
+    for (thread& worker : workers) worker.join();
+    freeze();
+    if (badLines > 0) cout << "Warning: skipped " << badLines << " malformed lines in " << path << endl;
+    return true;
+}
+
+// FNV-1a over 8-byte words (then the leftover bytes), continuing from hash
+uint64_t cacheChecksum(const char* data, size_t bytes, uint64_t hash) {
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < bytes; i++) hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    return hash;
+}
+
+const char graphCacheMagic[8] = {'E', 'S', 'G', 'R', 'A', 'P', 'H', '\n'};
+const uint32_t graphCacheVersion = 2;  // 2: repeated roads are merged
+
+// Size and modification time of the edge list, so a cache built from an older copy is not used
+bool sourceStamp(const string& path, uint64_t& bytes, int64_t& modified) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    bytes = (uint64_t)info.st_size;
+    modified = (int64_t)info.st_mtime;
+    return true;
+}
+
+bool Graph::saveCache(const string& path, const string& sourcePath) {
+    freeze();
+    GraphCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, graphCacheMagic, sizeof(header.magic));
+    header.version = graphCacheVersion;
+    if (!sourceStamp(sourcePath, header.sourceBytes, header.sourceModified)) return false;
+    header.nodes = (uint64_t)nodeCount();
+    header.arcs = (uint64_t)targets.size();
+    string names;
+    for (const string& name : builder.names) {
+        names += name;
+        names.push_back('\0');
+    }
+    header.nameBytes = names.size();
+    uint64_t hash = 1469598103934665603ULL;
+    hash = cacheChecksum((const char*)offsets.data(), offsets.size() * sizeof(int), hash);
+    hash = cacheChecksum((const char*)targets.data(), targets.size() * sizeof(int), hash);
+    const vector<int>& weightArray = weights.current();
+    hash = cacheChecksum((const char*)weightArray.data(), weightArray.size() * sizeof(int), hash);
+    header.checksum = cacheChecksum(names.data(), names.size(), hash);
+
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary, ios::binary | ios::trunc);
+        if (!file.is_open()) return false;
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)offsets.data(), offsets.size() * sizeof(int));
+        file.write((const char*)targets.data(), targets.size() * sizeof(int));
+        file.write((const char*)weightArray.data(), weightArray.size() * sizeof(int));
+        file.write(names.data(), names.size());
+        if (!file) return false;
+    }
+#if defined(_WIN32)
+    remove(path.c_str()); // rename() does not replace an existing file on Windows
+#endif
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+// Replaces the graph with a cache written by saveCache() for the same edge
+// list. Returns false (leaving the graph alone) if the cache is missing,
+// stale or damaged.
+bool Graph::loadCache(const string& path, const string& sourcePath) {
+    MappedFile file;
+    if (!file.open(path) || file.Size() < sizeof(GraphCacheHeader)) return false;
+    GraphCacheHeader header;
+    memcpy(&header, file.Data(), sizeof(header));
+    uint64_t sourceBytes;
+    int64_t sourceModified;
+    if (memcmp(header.magic, graphCacheMagic, sizeof(header.magic)) != 0 || header.version != graphCacheVersion) return false;
+    if (!sourceStamp(sourcePath, sourceBytes, sourceModified) || sourceBytes != header.sourceBytes ||
+        sourceModified != header.sourceModified) return false;
+    if (header.nodes >= INT_MAX || header.arcs >= INT_MAX) return false;
+    uint64_t expected = sizeof(header) + (header.nodes + 1 + 2 * header.arcs) * sizeof(int) + header.nameBytes;
+    if (file.Size() != expected) return false;
+    const char* at = file.Data() + sizeof(header);
+    // same sections as saveCache() hashes them; they need not be 8-byte multiples
+    uint64_t hash = 1469598103934665603ULL;
+    const char* section = at;
+    for (uint64_t bytes : {(header.nodes + 1) * sizeof(int), header.arcs * sizeof(int), header.arcs * sizeof(int), header.nameBytes}) {
+        hash = cacheChecksum(section, bytes, hash);
+        section += bytes;
+    }
+    if (hash != header.checksum) return false;
+
+    GraphBuilder loaded;
+    const char* namesAt = at + (header.nodes + 1 + 2 * header.arcs) * sizeof(int);
+    const char* namesEnd = namesAt + header.nameBytes;
+    loaded.names.reserve(header.nodes);
+    loaded.ids.reserve(header.nodes);
+    while (namesAt < namesEnd) {
+        const char* nameEnd = (const char*)memchr(namesAt, '\0', namesEnd - namesAt);
+        if (nameEnd == nullptr) return false;
+        loaded.intern(string_view(namesAt, nameEnd - namesAt));
+        namesAt = nameEnd + 1;
+    }
+    if (loaded.names.size() != header.nodes) return false;
+
+    vector<int> loadedOffsets(header.nodes + 1), loadedTargets(header.arcs), loadedWeights(header.arcs);
+    memcpy(loadedOffsets.data(), at, loadedOffsets.size() * sizeof(int));
+    at += loadedOffsets.size() * sizeof(int);
+    memcpy(loadedTargets.data(), at, loadedTargets.size() * sizeof(int));
+    at += loadedTargets.size() * sizeof(int);
+    memcpy(loadedWeights.data(), at, loadedWeights.size() * sizeof(int));
+    // The checksum only catches accidents; check the structure the searches rely on
+    // too, so a bad cache is rebuilt from the edge list instead of read out of bounds
+    if (loadedOffsets[0] != 0 || loadedOffsets[header.nodes] != (int)header.arcs) return false;
+    for (uint64_t u = 0; u < header.nodes; u++) {
+        if (loadedOffsets[u] > loadedOffsets[u + 1]) return false;
+    }
+    int largest = 0;
+    for (uint64_t arc = 0; arc < header.arcs; arc++) {
+        if (loadedTargets[arc] < 0 || loadedTargets[arc] >= (int)header.nodes) return false;
+        if (loadedWeights[arc] < 0) return false; // the edge list loader rejects these too
+        largest = max(largest, loadedWeights[arc]);
+    }
+
+    offsets.swap(loadedOffsets);
+    targets.swap(loadedTargets);
+    maxRoadWeight = largest;
+    weights.replace(loadedWeights);
+    roads.clear();
+    builder = std::move(loaded);
+    version++;
+    distance.assign(header.nodes, INT_MAX);
+    parent.assign(header.nodes, -1);
+    visited.assign(header.nodes, 0);
+    return true;
+}
+
+// The synthetic grid city as an edge list, for trying the loader on a big file
+bool writeGridEdgeList(const string& path, int side, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> weight(1, 20);
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file.is_open()) return false;
+    string buffer;
+    buffer.reserve(1 << 20);
+    buffer += "from,to,weight\n";
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            string here = "r" + to_string(y) + "c" + to_string(x);
+            if (x + 1 < side) buffer += here + ",r" + to_string(y) + "c" + to_string(x + 1) + "," + to_string(weight(rng)) + "\n";
+            if (y + 1 < side) buffer += here + ",r" + to_string(y + 1) + "c" + to_string(x) + "," + to_string(weight(rng)) + "\n";
+            if (buffer.size() > (1 << 20) - 256) {
+                file.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+    }
+    file.write(buffer.data(), buffer.size());
+    return (bool)file;
+}
+
+// --load <edges> [--threads N] [--cache <file>] [--no-menu]: reads the road network
+// from the cache when it matches the edge list, otherwise parses the edge list
+// (and writes the cache for next time)
+bool loadRoadNetwork(Graph& graph, int argc, char* argv[], bool& menu) {
+    if (argc < 3) {
+        cout << "Usage: Emergency_Services --load <edges.csv> [--threads N] [--cache <graph.bin>] [--no-menu]" << endl;
+        return false;
+    }
+    string path = argv[2], cachePath;
+    int threads = (int)thread::hardware_concurrency();
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (arg == "--cache" && i + 1 < argc) cachePath = argv[++i];
+        else if (arg == "--no-menu") menu = false;
+        else {
+            cout << "Unknown option " << arg << endl;
+            return false;
+        }
+    }
+    auto startTime = chrono::steady_clock::now();
+    bool cached = !cachePath.empty() && graph.loadCache(cachePath, path);
+    if (!cached && !graph.loadEdgeList(path, threads)) return false;
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    cout << "Loaded " << graph.nodeCount() << " locations and " << graph.edgeCount() / 2 << " roads from "
+         << (cached ? cachePath : path) << " in " << ms << " ms" << endl;
+    if (!cachePath.empty() && !cached) {
+        startTime = chrono::steady_clock::now();
+        if (graph.saveCache(cachePath, path)) {
+            ms = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+            cout << "Wrote cache " << cachePath << " in " << ms << " ms" << endl;
+        } else {
+            cout << "Warning: could not write cache " << cachePath << endl;
+        }
+    }
+    return true;
+}
+
+int Graph::roadWeight(int from, int to) {
+    freeze();
+    WeightReader weight(weights);
+    int best = INT_MAX;
+    for (int e = offsets[from]; e < offsets[from + 1]; e++) {
+        if (targets[e] == to) best = min(best, weight[e]);
+    }
+    return best;
+}
+
+void Graph::buildRouteIndex() {
+    freeze();
+    hierarchy.build(*this);
+}
+
+bool Graph::hasRouteIndex() {
+    freeze();
+    return hierarchy.built && hierarchy.graphVersion == version;
+}
+
+int Graph::route(int start, int end, vector<int>* path) {
+    if (hasRouteIndex()) return hierarchy.query(start, end, path, nullptr);
+    return shortestPath(start, end, path);
+}
+
+// Route search strategies
+const char* routeStrategyName(RouteStrategy strategy) {
+    switch (strategy) {
+    case ROUTE_AUTO: return "automatic";
+    case ROUTE_DIJKSTRA: return "Dijkstra";
+    case ROUTE_BIDIRECTIONAL: return "bidirectional Dijkstra";
+    case ROUTE_LANDMARKS: return "landmark A*";
+    case ROUTE_HIERARCHY: return "contraction hierarchy";
+    }
+    return "unknown";
+}
+
+int Graph::findRoute(int start, int end, RouteStrategy strategy, vector<int>* path, RouteStats* stats) {
+    auto startTime = chrono::steady_clock::now();
+    freeze();
+    if (strategy == ROUTE_AUTO) strategy = hasRouteIndex() ? ROUTE_HIERARCHY : hasLandmarks() ? ROUTE_LANDMARKS : ROUTE_DIJKSTRA;
+    if ((strategy == ROUTE_HIERARCHY && !hasRouteIndex()) || (strategy == ROUTE_LANDMARKS && !hasLandmarks())) strategy = ROUTE_DIJKSTRA;
+    long long settled = 0;
+    int result;
+    switch (strategy) {
+    case ROUTE_BIDIRECTIONAL: result = bidirectionalPathWith(routeQueues, start, end, path, &settled); break;
+    case ROUTE_LANDMARKS: result = landmarkPathWith(routeQueues[0], start, end, path, &settled); break;
+    case ROUTE_HIERARCHY: result = hierarchy.query(start, end, path, &settled); break;
+    default: result = shortestPath(start, end, path, &settled); break;
+    }
+    if (stats != nullptr) {
+        stats->used = strategy;
+        stats->settled = settled;
+        stats->microseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+    }
+    return result;
+}
+
+// Full Dijkstra from source, for landmark preprocessing and cached route trees
+void Graph::distancesFrom(int source, vector<int>& dist, vector<int>* parents) {
+    WeightReader weight(weights);
+    dist.assign(nodeCount(), INT_MAX);
+    if (parents != nullptr) parents->assign(nodeCount(), -1);
+    DistanceHeap heap;
+    dist[source] = 0;
+    heap.push({0, source});
+    while (!heap.empty()) {
+        int current = heap.top().second;
+        int currentDist = heap.top().first;
+        heap.pop();
+        if (currentDist > dist[current]) continue;
+        for (int e = offsets[current]; e < offsets[current + 1]; e++) {
+            int newDist = currentDist + weight[e];
+            if (newDist < dist[targets[e]]) {
+                dist[targets[e]] = newDist;
+                if (parents != nullptr) (*parents)[targets[e]] = current;
+                heap.push({newDist, targets[e]});
+            }
+        }
+    }
+}
+
+// Farthest-point selection: each new landmark is the location farthest from
+// the ones already chosen (the first, farthest from location 0), which puts
+// them around the edge of the map where their bounds are tightest
+void Graph::buildLandmarks(int count) {
+    auto startTime = chrono::steady_clock::now();
+    freeze();
+    int nodes = nodeCount();
+    unsigned long long builtFrom = version;
+    count = max(1, min(count, nodes));
+    landmarks.landmarks.clear();
+    landmarks.distances.assign((size_t)nodes * count, INT_MAX);
+    if (nodes == 0) return;
+    vector<int> dist, nearest(nodes, INT_MAX);
+    distancesFrom(0, dist);
+    for (int i = 0; i < count; i++) {
+        int pick = 0;
+        const vector<int>& from = i == 0 ? dist : nearest;
+        for (int v = 1; v < nodes; v++) {
+            // unreachable locations count as nearest, so a landmark stays in the component it can serve
+            int here = from[v] == INT_MAX ? -1 : from[v];
+            int best = from[pick] == INT_MAX ? -1 : from[pick];
+            if (here > best) pick = v;
+        }
+        landmarks.landmarks.push_back(pick);
+        distancesFrom(pick, dist);
+        for (int v = 0; v < nodes; v++) {
+            landmarks.distances[(size_t)v * count + i] = dist[v];
+            nearest[v] = min(nearest[v], dist[v]);
+        }
+    }
+    landmarks.graphVersion = builtFrom;
+    landmarks.built = true;
+    landmarks.buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+}
+
+bool Graph::hasLandmarks() {
+    freeze();
+    return landmarks.built && landmarks.graphVersion == version;
+}
+
+int Graph::landmarkBound(int node, int end) {
+    size_t count = landmarks.landmarks.size();
+    const int* here = &landmarks.distances[(size_t)node * count];
+    const int* there = &landmarks.distances[(size_t)end * count];
+    int bound = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (here[i] == INT_MAX || there[i] == INT_MAX) continue;
+        bound = max(bound, abs(there[i] - here[i]));
+    }
+    return bound;
+}
+
+// A* on distance plus landmark bound; the bound is consistent, so a location
+// is final the first time it is taken off the queue, as in Dijkstra. Keys still
+// never drop below the last one popped, but a push may land up to twice the
+// largest road weight above it (the weight plus the change in bound).
+template <class Queue>
+int Graph::landmarkPathWith(Queue& queue, int start, int end, vector<int>* path, long long* settled) {
+    freeze();
+    SearchScratch& scratch = routeScratch[0];
+    int nodes = nodeCount();
+    if ((int)scratch.distance.size() != nodes) {
+        scratch.distance.assign(nodes, INT_MAX);
+        scratch.parent.assign(nodes, -1);
+    }
+    WeightReader weight(weights);
+    queue.prepare(2 * maxRoadWeight.load());
+    vector<int>& dist = scratch.distance;
+    dist[start] = 0;
+    scratch.touched.push_back(start);
+    queue.push(landmarkBound(start, end), start);
+    while (!queue.empty()) {
+        pair<int, int> top = queue.pop();
+        int current = top.second;
+        if (top.first - landmarkBound(current, end) > dist[current]) continue;
+        if (settled != nullptr) (*settled)++;
+        if (current == end) break;
+        for (int e = offsets[current]; e < offsets[current + 1]; e++) {
+            int neighbor = targets[e];
+            int newDist = dist[current] + weight[e];
+            if (newDist < dist[neighbor]) {
+                if (dist[neighbor] == INT_MAX) scratch.touched.push_back(neighbor);
+                dist[neighbor] = newDist;
+                scratch.parent[neighbor] = current;
+                queue.push(newDist + landmarkBound(neighbor, end), neighbor);
+            }
+        }
+    }
+
+    int result = dist[end];
+    if (path != nullptr) {
+        path->clear();
+        if (result != INT_MAX) {
+            for (int node = end; node != start; node = scratch.parent[node]) path->push_back(node);
+            path->push_back(start);
+            reverse(path->begin(), path->end());
+        }
+    }
+    for (int node : scratch.touched) {
+        dist[node] = INT_MAX;
+        scratch.parent[node] = -1;
+    }
+    scratch.touched.clear();
+    return result;
+}
+
+// Dijkstra from both ends at once, one queue per side, always advancing the
+// side with the smaller top key; once the two tops add up to at least the best
+// meeting found, no shorter route can remain
+template <class Queue>
+int Graph::bidirectionalPathWith(Queue (&queues)[2], int start, int end, vector<int>* path, long long* settled) {
+    freeze();
+    int nodes = nodeCount();
+    WeightReader weight(weights);
+    int maxWeight = maxRoadWeight.load();   // read after the weights, so it covers them
+    for (int side = 0; side < 2; side++) {
+        SearchScratch& scratch = routeScratch[side];
+        if ((int)scratch.distance.size() != nodes) {
+            scratch.distance.assign(nodes, INT_MAX);
+            scratch.parent.assign(nodes, -1);
+        }
+        queues[side].prepare(maxWeight);
+        int origin = side == 0 ? start : end;
+        scratch.distance[origin] = 0;
+        scratch.touched.push_back(origin);
+        queues[side].push(0, origin);
+    }
+    int best = INT_MAX, meet = -1;
+    while (!queues[0].empty() && !queues[1].empty()) {
+        int top0 = queues[0].topKey();
+        int top1 = queues[1].topKey();
+        if (best != INT_MAX && top0 + top1 >= best) break;
+        int side = top0 <= top1 ? 0 : 1;
+        SearchScratch& here = routeScratch[side];
+        SearchScratch& other = routeScratch[1 - side];
+        pair<int, int> top = queues[side].pop();
+        int current = top.second;
+        int currentDist = top.first;
+        if (currentDist > here.distance[current]) continue;
+        if (settled != nullptr) (*settled)++;
+        for (int e = offsets[current]; e < offsets[current + 1]; e++) {
+            int neighbor = targets[e];
+            int newDist = currentDist + weight[e];
+            if (newDist < here.distance[neighbor]) {
+                if (here.distance[neighbor] == INT_MAX) here.touched.push_back(neighbor);
+                here.distance[neighbor] = newDist;
+                here.parent[neighbor] = current;
+                queues[side].push(newDist, neighbor);
+            }
+            if (here.distance[neighbor] != INT_MAX && other.distance[neighbor] != INT_MAX &&
+                here.distance[neighbor] + other.distance[neighbor] < best) {
+                best = here.distance[neighbor] + other.distance[neighbor];
+                meet = neighbor;
+            }
+        }
+    }
+    if (start == end) {
+        best = 0;
+        meet = start;
+    }
+
+    if (path != nullptr) {
+        path->clear();
+        if (meet >= 0) {
+            for (int node = meet; node != start; node = routeScratch[0].parent[node]) path->push_back(node);
+            path->push_back(start);
+            reverse(path->begin(), path->end());
+            for (int node = meet; node != end; node = routeScratch[1].parent[node]) path->push_back(routeScratch[1].parent[node]);
+        }
+    }
+    for (int side = 0; side < 2; side++) {
+        SearchScratch& scratch = routeScratch[side];
+        for (int node : scratch.touched) {
+            scratch.distance[node] = INT_MAX;
+            scratch.parent[node] = -1;
+        }
+        scratch.touched.clear();
+    }
+    return best;
+}
+
+// RouteCache methods
+void RouteCache::invalidate(unsigned long long version) {
+    if (!entries.empty() || !trees.empty()) invalidations++;
+    entries.clear();
+    index.clear();
+    trees.clear();
+    originMisses.clear();
+    graphVersion = version;
+}
+
+// Routes first, then a tree rooted at either end (roads run both ways, so a
+// tree from the destination holds the route backwards)
+// counted is false for a second look at the same request, so it is not counted twice
+bool RouteCache::find(int start, int end, int& distance, vector<int>* path, bool counted) {
+    auto found = index.find(routeKey(start, end));
+    if (found != index.end()) {
+        entries.splice(entries.begin(), entries, found->second);
+        distance = found->second->distance;
+        if (path != nullptr) *path = found->second->path;
+        if (counted) hits++;
+        return true;
+    }
+    for (auto tree = trees.begin(); tree != trees.end(); ++tree) {
+        if (tree->origin != start && tree->origin != end) continue;
+        int target = tree->origin == start ? end : start;
+        distance = tree->distance[target];
+        if (path != nullptr) {
+            path->clear();
+            if (distance != INT_MAX) {
+                for (int node = target; node >= 0; node = tree->parent[node]) path->push_back(node);
+                if (tree->origin == start) reverse(path->begin(), path->end());
+            }
+        }
+        trees.splice(trees.begin(), trees, tree);
+        if (counted) treeHits++;
+        return true;
+    }
+    if (counted) misses++;
+    return false;
+}
+
+void RouteCache::insert(int start, int end, int distance, const vector<int>& path) {
+    if (capacity == 0) return;
+    uint64_t key = routeKey(start, end);
+    if (index.count(key) != 0) return;
+    if (entries.size() >= capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.push_front({key, distance, path});
+    index[key] = entries.begin();
+}
+
+bool RouteCache::wantsTree(int origin) {
+    return treeCapacity > 0 && ++originMisses[origin] >= hotAfter;
+}
+
+void RouteCache::insertTree(int origin, vector<int>& distance, vector<int>& parent) {
+    if (trees.size() >= treeCapacity) trees.pop_back();
+    trees.push_front(Tree());
+    trees.front().origin = origin;
+    trees.front().distance.swap(distance);
+    trees.front().parent.swap(parent);
+    originMisses.erase(origin);
+}
+
+double RouteCache::hitRate() {
+    long long lookups = hits + treeHits + misses;
+    return lookups == 0 ? 0 : 100.0 * (hits + treeHits) / lookups;
+}
+
+// Approximate: list and hash nodes at two pointers of overhead each
+size_t RouteCache::memoryBytes() {
+    size_t bytes = index.bucket_count() * sizeof(void*) + originMisses.size() * (sizeof(pair<int, int>) + 2 * sizeof(void*));
+    for (const Entry& entry : entries) {
+        bytes += sizeof(Entry) + entry.path.capacity() * sizeof(int) + 4 * sizeof(void*) + sizeof(uint64_t);
+    }
+    for (const Tree& tree : trees) bytes += sizeof(Tree) + (tree.distance.capacity() + tree.parent.capacity()) * sizeof(int);
+    return bytes;
+}
+
+// Cached routes
+int Graph::cachedRoute(int start, int end, vector<int>* path, RouteStats* stats) {
+    auto startTime = chrono::steady_clock::now();
+    freeze();   // pending roads bump the version here
+    if (routeCache.graphVersion != version) routeCache.invalidate(version);
+    int result;
+    bool hit = routeCache.find(start, end, result, path);
+    if (!hit && routeCache.wantsTree(start)) {
+        vector<int> dist, parents;
+        distancesFrom(start, dist, &parents);
+        routeCache.insertTree(start, dist, parents);
+        hit = routeCache.find(start, end, result, path, false); // already counted as a miss
+    }
+    if (hit) {
+        if (stats != nullptr) {
+            *stats = RouteStats();
+            stats->cached = true;
+            stats->microseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+        }
+        return result;
+    }
+    vector<int> route;
+    result = findRoute(start, end, routeStrategy, &route, stats);
+    routeCache.insert(start, end, result, route);
+    if (path != nullptr) path->swap(route);
+    return result;
+}
+
+void Graph::displayCacheStats() {
+    freeze();
+    if (routeCache.graphVersion != version) routeCache.invalidate(version);
+    cout << "Route cache: " << routeCache.routeCount() << " routes (limit " << routeCache.capacity << "), "
+         << routeCache.treeCount() << " origin trees (limit " << routeCache.treeCapacity << "), about "
+         << routeCache.memoryBytes() / 1024 << " KB" << endl;
+    cout << "Hits " << routeCache.hits << " + " << routeCache.treeHits << " from trees, misses " << routeCache.misses
+         << ", hit rate " << routeCache.hitRate() << "%, cleared " << routeCache.invalidations << " time(s) by road changes" << endl;
+}
+
+// RoadIndex methods
+uint64_t RoadIndex::roadKey(int u, int v) {
+    if (u > v) swap(u, v);
+    return ((uint64_t)(u + 1) << 32) | (uint32_t)(v + 1);
+}
 
-public:
-    void addEdge(string u, string v, int weight);
-    void displayGraph();
-    void bfs(string start);
-    void dfs(string start);
-    void ambulanceRouteOptimization(string start, string end);
+void RoadIndex::build(const vector<int>& offsets, const vector<int>& targets) {
+    size_t wanted = 16;
+    while (wanted < targets.size()) wanted <<= 1;   // one slot per arc: at most half full
+    slots.assign(wanted, Slot{0, -1, -1});
+    mask = wanted - 1;
+    int nodes = (int)offsets.size() - 1;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int u = 0; u < nodes; u++) {
+            for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+                int v = targets[e];
+                if ((pass == 0) != (u <= v)) continue;   // low -> high arcs first
+                uint64_t key = roadKey(u, v);
+                size_t at = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+                while (slots[at].key != 0 && slots[at].key != key) at = (at + 1) & mask;
+                slots[at].key = key;
+                if (pass == 0) slots[at].forward = e;
+                if (pass == 1 || u == v) slots[at].backward = e;
+            }
+        }
+    }
+    built = true;
+}
 
-private:
-    void dfsUtil(string node, unordered_map<string, bool>& visited);
-};
+bool RoadIndex::find(int u, int v, int& forward, int& backward) const {
+    if (!built) return false;
+    uint64_t key = roadKey(u, v);
+    for (size_t at = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask; slots[at].key != 0; at = (at + 1) & mask) {
+        if (slots[at].key != key) continue;
+        forward = u <= v ? slots[at].forward : slots[at].backward;
+        backward = u <= v ? slots[at].backward : slots[at].forward;
+        return true;
+    }
+    return false;
+}
 
-class CrowdControl {
-    Stack crowdStack;
-    queue<string> crowdQueue;
+void RoadIndex::clear() {
+    vector<Slot>().swap(slots);
+    mask = 0;
+    built = false;
+}
 
-public:
-    void addPersonToStack(string name);
-    void removePersonFromStack();
-    void emptyCrowdStack();
-    void displayCrowdStack();
-    void addPersonToQueue(string name);
-    void removePersonFromQueue();
-    void emptyCrowdQueue();
-    void displayCrowdQueue();
-};
+size_t RoadIndex::memoryBytes() {
+    return slots.capacity() * sizeof(Slot);
+}
 
-// Stack methods
-void Stack::push(string name) {
-    stack.push_back(name);
+// RoadWeights methods
+RoadWeights::RoadWeights() {
+    live = 0;
+    readers[0] = 0;
+    readers[1] = 0;
 }
 
-void Stack::pop() {
-    if (!stack.empty()) {
-        stack.pop_back();
+vector<int>& RoadWeights::current() {
+    return copies[live.load()];
+}
+
+void RoadWeights::replace(vector<int>& weights) {
+    copies[live.load()].swap(weights);
+    vector<int>().swap(copies[1 - live.load()]);
+    lastArcs.clear();
+    spareCurrent = false;
+}
+
+void RoadWeights::publish(const vector<RoadUpdate>& batch, const vector<int>& arcs) {
+    lock_guard<mutex> lock(updateLock);
+    int from = live.load();
+    int to = 1 - from;
+    // searches that started before the previous batch may still be on the spare copy
+    while (readers[to].load() != 0) this_thread::yield();
+    vector<int>& spare = copies[to];
+    if (!spareCurrent) {
+        spare = copies[from];
+    } else {
+        for (int arc : lastArcs) spare[arc] = copies[from][arc];
+    }
+    for (size_t i = 0; i < batch.size(); i++) {
+        spare[arcs[2 * i]] = batch[i].weight;
+        spare[arcs[2 * i + 1]] = batch[i].weight;
     }
+    live.store(to);
+    lastArcs = arcs;
+    spareCurrent = true;
 }
 
-string Stack::top() {
-    if (!stack.empty()) {
-        return stack.back();
+size_t RoadWeights::memoryBytes() {
+    return (copies[0].capacity() + copies[1].capacity() + lastArcs.capacity()) * sizeof(int);
+}
+
+// WeightReader methods
+WeightReader::WeightReader(RoadWeights& weights) : table(weights) {
+    while (true) {
+        side = table.live.load();
+        table.readers[side]++;
+        if (table.live.load() == side) break;
+        table.readers[side]--;   // a batch was published in between; use the new copy
     }
-    return "";
+    data = table.copies[side].data();
 }
 
-bool Stack::empty() {
-    return stack.empty();
+WeightReader::~WeightReader() {
+    table.readers[side]--;
 }
 
-void Stack::clear() {
-    stack.clear();
+// Congestion update methods
+void Graph::buildRoadIndex() {
+    freeze();
+    roads.build(offsets, targets);
 }
 
-void Stack::display() {
-    if (stack.empty()) {
-        cout << "Stack is empty." << endl;
-    } else {
-        cout << "Stack contents: ";
-        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
-            cout << *it << " ";
+bool Graph::updateRoad(const string& u, const string& v, int weight) {
+    int from = findLocation(u);
+    int to = findLocation(v);
+    if (from < 0 || to < 0) return false;
+    return updateRoads(vector<RoadUpdate>{{from, to, weight}}) == 1;
+}
+
+// O(1) per road through the road index; unknown roads and negative weights are
+// skipped. The version bump makes route and dispatch indexes fall back to
+// searching the live weights until they are rebuilt.
+int Graph::updateRoads(const vector<RoadUpdate>& batch) {
+    freeze();
+    if (!roads.built) buildRoadIndex();
+    vector<RoadUpdate> found;
+    vector<int> arcs;
+    found.reserve(batch.size());
+    arcs.reserve(2 * batch.size());
+    for (const RoadUpdate& update : batch) {
+        int forward, backward;
+        if (update.weight < 0 || !roads.find(update.from, update.to, forward, backward)) continue;
+        found.push_back(update);
+        arcs.push_back(forward);
+        arcs.push_back(backward);
+    }
+    if (found.empty()) return 0;
+    // raised before the weights are published, so no search sees a weight above it
+    for (const RoadUpdate& update : found) {
+        if (update.weight > maxRoadWeight) maxRoadWeight = update.weight;
+    }
+    weights.publish(found, arcs);
+    version++;
+    return (int)found.size();
+}
+
+// Dispatch methods
+bool Graph::addStation(const string& name) {
+    int id = findLocation(name);
+    if (id < 0) return false;
+    if (find(stations.begin(), stations.end(), id) == stations.end()) {
+        stations.push_back(id);
+        coverage.built = false;
+    }
+    return true;
+}
+
+const vector<int>& Graph::stationList() {
+    return stations;
+}
+
+void Graph::dispatchUnit(string incident) {
+    int to = findLocation(incident);
+    if (to < 0 || stations.empty()) {
+        cout << (stations.empty() ? "No stations registered." : "Unknown location: " + incident) << endl;
+        return;
+    }
+    if (!hasStationCoverage()) buildStationCoverage();
+    DispatchResult result = coveredStation(to);
+    if (result.station < 0) {
+        cout << "No station can reach " << incident << endl;
+        return;
+    }
+    cout << "Dispatch from " << builder.names[result.station] << ": ";
+    for (size_t i = 0; i < result.route.size(); i++) {
+        if (i > 0) cout << " -> ";
+        cout << builder.names[result.route[i]];
+    }
+    cout << " | Distance: " << result.distance << endl;
+}
+
+// Dijkstra outwards from the incident, stopping at the first station settled.
+// Roads run both ways, so that is the station closest to the incident and the
+// parent chain is its route. Only reads the CSR arrays, so callers with their
+// own scratch may run it in parallel once the graph is frozen.
+DispatchResult Graph::nearestStation(const vector<int>& from, int incident, SearchScratch& scratch) {
+    DispatchResult result;
+    result.incident = incident;
+    int nodes = (int)offsets.size() - 1;
+    if ((int)scratch.distance.size() != nodes) {
+        scratch.distance.assign(nodes, INT_MAX);
+        scratch.parent.assign(nodes, -1);
+        scratch.isStation.assign(nodes, 0);
+        scratch.touched.clear();
+    }
+    WeightReader weight(weights);
+    vector<int>& dist = scratch.distance;
+    DistanceHeap& heap = scratch.heap;
+    while (!heap.empty()) heap.pop();
+    for (int station : from) scratch.isStation[station] = 1;
+    dist[incident] = 0;
+    scratch.touched.push_back(incident);
+    heap.push({0, incident});
+
+    int found = -1;
+    while (!heap.empty()) {
+        int current = heap.top().second;
+        int currentDist = heap.top().first;
+        heap.pop();
+        if (currentDist > dist[current]) continue;
+        if (scratch.isStation[current]) {
+            found = current;
+            break;
         }
-        cout << endl;
+        for (int e = offsets[current]; e < offsets[current + 1]; e++) {
+            int neighbor = targets[e];
+            int newDist = currentDist + weight[e];
+            if (newDist < dist[neighbor]) {
+                if (dist[neighbor] == INT_MAX) scratch.touched.push_back(neighbor);
+                dist[neighbor] = newDist;
+                scratch.parent[neighbor] = current;
+                heap.push({newDist, neighbor});
+            }
+        }
+    }
+
+    if (found >= 0) {
+        result.station = found;
+        result.distance = dist[found];
+        for (int node = found; node >= 0; node = scratch.parent[node]) result.route.push_back(node);
+    }
+    for (int node : scratch.touched) {
+        dist[node] = INT_MAX;
+        scratch.parent[node] = -1;
     }
+    for (int station : from) scratch.isStation[station] = 0;
+    scratch.touched.clear();
+    return result;
 }
 
-// Graph methods
-void Graph::addEdge(string u, string v, int weight) {
-    adjList[u].push_back({v, weight});
-    adjList[v].push_back({u, weight});
+// Resolves incidents in parallel; thread t takes every threads-th incident so
+// the results stay in input order without any locking
+void Graph::dispatchIncidents(const vector<int>& from, const vector<int>& incidents, vector<DispatchResult>& results, int threads) {
+    freeze();
+    results.assign(incidents.size(), DispatchResult());
+    threads = max(1, min(threads, (int)incidents.size()));
+    auto work = [&](int t) {
+        SearchScratch scratch;
+        for (size_t i = t; i < incidents.size(); i += threads) results[i] = nearestStation(from, incidents[i], scratch);
+    };
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) workers.emplace_back(work, t);
+    work(0);
+    for (thread& worker : workers) worker.join();
 }
 
-void Graph::displayGraph() {
-    cout << "Graph Representation:" << endl;
-    for (auto& node : adjList) {
-        cout << node.first << " -> ";
-        for (auto& neighbor : node.second) {
-            cout << "(" << neighbor.first << ", " << neighbor.second << ") ";
+// Every station starts at distance 0 and the search runs to the end, so each
+// location is settled from the station closest to it. Worth it once there are
+// more incidents than a few per station, or when the menu asks repeatedly.
+void Graph::buildStationCoverage() {
+    freeze();
+    int nodes = nodeCount();
+    unsigned long long builtFrom = version;
+    coverage.station.assign(nodes, -1);
+    coverage.distance.assign(nodes, INT_MAX);
+    coverage.parent.assign(nodes, -1);
+    WeightReader weight(weights);
+    DistanceHeap heap;
+    for (int station : stations) {
+        coverage.station[station] = station;
+        coverage.distance[station] = 0;
+        heap.push({0, station});
+    }
+    while (!heap.empty()) {
+        int current = heap.top().second;
+        int currentDist = heap.top().first;
+        heap.pop();
+        if (currentDist > coverage.distance[current]) continue;
+        for (int e = offsets[current]; e < offsets[current + 1]; e++) {
+            int neighbor = targets[e];
+            int newDist = currentDist + weight[e];
+            if (newDist < coverage.distance[neighbor]) {
+                coverage.distance[neighbor] = newDist;
+                coverage.parent[neighbor] = current;
+                coverage.station[neighbor] = coverage.station[current];
+                heap.push({newDist, neighbor});
+            }
         }
-        cout << endl;
     }
+    coverage.graphVersion = builtFrom;
+    coverage.built = true;
 }
 
-void Graph::bfs(string start) {
-    queue<string> q;
-    unordered_map<string, bool> visited;
+bool Graph::hasStationCoverage() {
+    freeze();
+    return coverage.built && coverage.graphVersion == version;
+}
 
-    q.push(start);
-    visited[start] = true;
+DispatchResult Graph::coveredStation(int incident) {
+    DispatchResult result;
+    result.incident = incident;
+    result.station = coverage.station[incident];
+    result.distance = coverage.distance[incident];
+    if (result.station >= 0) {
+        for (int node = incident; node >= 0; node = coverage.parent[node]) result.route.push_back(node);
+        reverse(result.route.begin(), result.route.end());
+    }
+    return result;
+}
 
-    cout << "BFS Traversal starting from " << start << ": ";
-    while (!q.empty()) {
-        string node = q.front();
-        q.pop();
-        cout << node << " ";
-
-        for (auto& neighbor : adjList[node]) {
-            if (!visited[neighbor.first]) {
-                visited[neighbor.first] = true;
-                q.push(neighbor.first);
+// HierarchyContractor methods
+HierarchyContractor::HierarchyContractor(const vector<int>& offsets, const vector<int>& targets, const WeightReader& weights) {
+    int nodes = (int)offsets.size() - 1;
+    adjacency.resize(nodes);
+    deletedNeighbors.assign(nodes, 0);
+    witnessDistance.assign(nodes, INT_MAX);
+    witnessTarget.assign(nodes, 0);
+    for (int u = 0; u < nodes; u++) {
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            if (targets[e] != u) addEdge(u, targets[e], weights[e], -1);
+        }
+    }
+}
+
+// Keeps only the shortest of parallel roads
+void HierarchyContractor::addEdge(int u, int v, int weight, int middle) {
+    for (ContractionEdge& edge : adjacency[u]) {
+        if (edge.to == v) {
+            if (weight < edge.weight) {
+                edge.weight = weight;
+                edge.middle = middle;
             }
+            return;
         }
     }
-    cout << endl;
+    adjacency[u].push_back({v, weight, middle});
 }
 
-void Graph::dfsUtil(string node, unordered_map<string, bool>& visited) {
-    cout << node << " ";
-    visited[node] = true;
+void HierarchyContractor::removeEdge(int u, int v) {
+    vector<ContractionEdge>& edges = adjacency[u];
+    for (size_t i = 0; i < edges.size(); i++) {
+        if (edges[i].to == v) {
+            edges[i] = edges.back();
+            edges.pop_back();
+            return;
+        }
+    }
+}
 
-    for (auto& neighbor : adjList[node]) {
-        if (!visited[neighbor.first]) {
-            dfsUtil(neighbor.first, visited);
+// Dijkstra from source around skip, stopping once all marked targets are
+// settled, past limit, or after maxSettled locations; a witness it misses only
+// costs an unneeded shortcut
+void HierarchyContractor::witnessSearch(int source, int skip, int limit, int targets, int maxSettled) {
+    for (int node : witnessTouched) witnessDistance[node] = INT_MAX;
+    witnessTouched.clear();
+    while (!witnessHeap.empty()) witnessHeap.pop();
+    witnessDistance[source] = 0;
+    witnessTouched.push_back(source);
+    witnessHeap.push({0, source});
+    int settled = 0;
+    while (!witnessHeap.empty() && settled < maxSettled) {
+        int dist = witnessHeap.top().first;
+        int node = witnessHeap.top().second;
+        witnessHeap.pop();
+        if (dist > witnessDistance[node]) continue;
+        if (dist > limit) break;
+        settled++;
+        if (witnessTarget[node] && --targets == 0) break;
+        for (const ContractionEdge& edge : adjacency[node]) {
+            if (edge.to == skip) continue;
+            int next = dist + edge.weight;
+            if (next < witnessDistance[edge.to]) {
+                if (witnessDistance[edge.to] == INT_MAX) witnessTouched.push_back(edge.to);
+                witnessDistance[edge.to] = next;
+                witnessHeap.push({next, edge.to});
+            }
         }
     }
 }
 
-void Graph::dfs(string start) {
-    unordered_map<string, bool> visited;
-    cout << "DFS Traversal starting from " << start << ": ";
-    dfsUtil(start, visited);
-    cout << endl;
+// Counts (and, when shortcuts is given, lists) the shortcuts contracting node needs
+int HierarchyContractor::findShortcuts(int node, vector<BuilderEdge>* shortcuts, int maxSettled) {
+    vector<ContractionEdge>& edges = adjacency[node];
+    int count = 0;
+    for (size_t i = 0; i + 1 < edges.size(); i++) {
+        int maxWeight = 0;
+        for (size_t j = i + 1; j < edges.size(); j++) {
+            maxWeight = max(maxWeight, edges[j].weight);
+            witnessTarget[edges[j].to] = 1;
+        }
+        witnessSearch(edges[i].to, node, edges[i].weight + maxWeight, (int)(edges.size() - i - 1), maxSettled);
+        for (size_t j = i + 1; j < edges.size(); j++) witnessTarget[edges[j].to] = 0;
+        for (size_t j = i + 1; j < edges.size(); j++) {
+            int via = edges[i].weight + edges[j].weight;
+            if (witnessDistance[edges[j].to] <= via) continue;
+            count++;
+            if (shortcuts != nullptr) shortcuts->push_back({edges[i].to, edges[j].to, via});
+        }
+    }
+    return count;
 }
 
-void Graph::ambulanceRouteOptimization(string start, string end) {
-    unordered_map<string, int> distance;
-    unordered_map<string, string> parent;
-    for (auto& node : adjList) {
-        distance[node.first] = INT_MAX;
+// Edge difference plus contracted neighbours: favours locations whose removal
+// adds few shortcuts, while spreading contraction evenly over the map. The
+// estimate uses a shorter witness search than contract() itself.
+int HierarchyContractor::priority(int node) {
+    return findShortcuts(node, nullptr, 50) - (int)adjacency[node].size() + deletedNeighbors[node];
+}
+
+void HierarchyContractor::contract(int node, vector<ContractionEdge>& upward, long long& shortcutCount) {
+    vector<BuilderEdge> shortcuts;
+    findShortcuts(node, &shortcuts, 500);
+    upward = adjacency[node];
+    for (const ContractionEdge& edge : upward) {
+        removeEdge(edge.to, node);
+        deletedNeighbors[edge.to]++;
     }
-    distance[start] = 0;
+    for (const BuilderEdge& shortcut : shortcuts) {
+        addEdge(shortcut.from, shortcut.to, shortcut.weight, node);
+        addEdge(shortcut.to, shortcut.from, shortcut.weight, node);
+    }
+    shortcutCount += (long long)shortcuts.size();
+    vector<ContractionEdge>().swap(adjacency[node]);
+}
 
-    priority_queue<pair<int, string>, vector<pair<int, string>>, greater<pair<int, string>>> pq;
-    pq.push({0, start});
+// ContractionHierarchy methods
+void ContractionHierarchy::build(Graph& graph) {
+    auto startTime = chrono::steady_clock::now();
+    graph.freeze();
+    int nodes = graph.nodeCount();
+    unsigned long long builtFrom = graph.version;   // read before the weights, so a racing update leaves it stale
+    HierarchyContractor contractor(graph.offsets, graph.targets, WeightReader(graph.weights));
+    vector<vector<ContractionEdge>> upward(nodes);
+    rank.assign(nodes, -1);
+    shortcuts = 0;
 
-    while (!pq.empty()) {
-        string current = pq.top().second;
-        int currentDist = pq.top().first;
-        pq.pop();
+    // lazy updates: a popped location is contracted only if its priority is
+    // still no worse than the next one's
+    DistanceHeap queue;
+    for (int node = 0; node < nodes; node++) queue.push({contractor.priority(node), node});
+    int nextRank = 0;
+    while (!queue.empty()) {
+        int node = queue.top().second;
+        queue.pop();
+        if (rank[node] >= 0) continue;
+        int current = contractor.priority(node);
+        if (!queue.empty() && current > queue.top().first) {
+            queue.push({current, node});
+            continue;
+        }
+        rank[node] = nextRank++;
+        contractor.contract(node, upward[node], shortcuts);
+    }
 
-        if (current == end) break;
+    upOffsets.assign(nodes + 1, 0);
+    for (int node = 0; node < nodes; node++) upOffsets[node + 1] = upOffsets[node] + (int)upward[node].size();
+    upTargets.resize(upOffsets[nodes]);
+    upWeights.resize(upOffsets[nodes]);
+    upMiddles.resize(upOffsets[nodes]);
+    for (int node = 0; node < nodes; node++) {
+        int at = upOffsets[node];
+        for (const ContractionEdge& edge : upward[node]) {
+            upTargets[at] = edge.to;
+            upWeights[at] = edge.weight;
+            upMiddles[at++] = edge.middle;
+        }
+        vector<ContractionEdge>().swap(upward[node]);
+    }
+    for (int side = 0; side < 2; side++) {
+        distance[side].assign(nodes, INT_MAX);
+        parentNode[side].assign(nodes, -1);
+        parentEdge[side].assign(nodes, -1);
+        touched[side].clear();
+    }
+    graphVersion = builtFrom;
+    built = true;
+    buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+}
+
+// The edge between low and high stored at low, where low was contracted first
+int ContractionHierarchy::findUpEdge(int low, int high) {
+    for (int e = upOffsets[low]; e < upOffsets[low + 1]; e++) {
+        if (upTargets[e] == high) return e;
+    }
+    return -1;
+}
+
+// Appends the locations after from, up to and including to, that the edge stands for
+void ContractionHierarchy::unpackEdge(int from, int to, int middle, vector<int>& path) {
+    if (middle < 0) {
+        path.push_back(to);
+        return;
+    }
+    unpackEdge(from, middle, upMiddles[findUpEdge(middle, from)], path);
+    unpackEdge(middle, to, upMiddles[findUpEdge(middle, to)], path);
+}
 
-        for (auto& neighbor : adjList[current]) {
-            int newDist = currentDist + neighbor.second;
-            if (newDist < distance[neighbor.first]) {
-                distance[neighbor.first] = newDist;
-                pq.push({newDist, neighbor.first});
-                parent[neighbor.first] = current;
+// Two upward searches, one from each end, taking turns by smaller distance.
+// A location is not expanded when a higher one already reaches it more
+// cheaply (stall-on-demand), and the search ends once neither side can still
+// improve on the best meeting point.
+int ContractionHierarchy::query(int start, int end, vector<int>* path, long long* settled) {
+    DistanceHeap heaps[2];
+    for (int side = 0; side < 2; side++) {
+        int origin = side == 0 ? start : end;
+        distance[side][origin] = 0;
+        touched[side].push_back(origin);
+        heaps[side].push({0, origin});
+    }
+    int best = INT_MAX, meet = -1;
+    long long settledCount = 0;
+    while (true) {
+        int top0 = heaps[0].empty() ? INT_MAX : heaps[0].top().first;
+        int top1 = heaps[1].empty() ? INT_MAX : heaps[1].top().first;
+        if (min(top0, top1) >= best) break;
+        int side = top0 <= top1 ? 0 : 1;
+        int dist = heaps[side].top().first;
+        int node = heaps[side].top().second;
+        heaps[side].pop();
+        if (dist > distance[side][node]) continue;
+        settledCount++;
+        if (distance[1 - side][node] != INT_MAX && dist + distance[1 - side][node] < best) {
+            best = dist + distance[1 - side][node];
+            meet = node;
+        }
+        bool stalled = false;
+        for (int e = upOffsets[node]; e < upOffsets[node + 1] && !stalled; e++) {
+            int above = distance[side][upTargets[e]];
+            stalled = above != INT_MAX && above + upWeights[e] < dist;
+        }
+        if (stalled) continue;
+        for (int e = upOffsets[node]; e < upOffsets[node + 1]; e++) {
+            int next = upTargets[e];
+            int nextDist = dist + upWeights[e];
+            if (nextDist < distance[side][next]) {
+                if (distance[side][next] == INT_MAX) touched[side].push_back(next);
+                distance[side][next] = nextDist;
+                parentNode[side][next] = node;
+                parentEdge[side][next] = e;
+                heaps[side].push({nextDist, next});
             }
         }
     }
 
-    if (distance[end] == INT_MAX) {
-        cout << "No route found from " << start << " to " << end << endl;
-    } else {
-        cout << "Optimized Route (Ambulance): ";
-        string node = end;
-        Stack path;
-        while (node != start) {
-            path.push(node);
-            node = parent[node];
+    if (path != nullptr) {
+        path->clear();
+        if (meet >= 0) {
+            vector<int> climb;
+            for (int node = meet; node != start; node = parentNode[0][node]) climb.push_back(node);
+            path->push_back(start);
+            for (int i = (int)climb.size() - 1; i >= 0; i--) {
+                int node = climb[i];
+                unpackEdge(parentNode[0][node], node, upMiddles[parentEdge[0][node]], *path);
+            }
+            for (int node = meet; node != end; node = parentNode[1][node]) {
+                unpackEdge(node, parentNode[1][node], upMiddles[parentEdge[1][node]], *path);
+            }
+        }
+    }
+    for (int side = 0; side < 2; side++) {
+        for (int node : touched[side]) {
+            distance[side][node] = INT_MAX;
+            parentNode[side][node] = -1;
+            parentEdge[side][node] = -1;
+        }
+        touched[side].clear();
+    }
+    if (settled != nullptr) *settled = settledCount;
+    return best;
+}
+
+size_t ContractionHierarchy::memoryBytes() {
+    return (rank.capacity() + upOffsets.capacity() + upTargets.capacity() + upWeights.capacity() + upMiddles.capacity()) * sizeof(int);
+}
+
+// Synthetic city for benchmarks: a width x height street grid with random
+// travel times of 1-20 on every block
+void buildGridCity(Graph& graph, int width, int height, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> weight(1, 20);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) graph.addLocation("r" + to_string(y) + "c" + to_string(x));
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int id = y * width + x;
+            if (x + 1 < width) graph.addEdge(id, id + 1, weight(rng));
+            if (y + 1 < height) graph.addEdge(id, id + width, weight(rng));
+        }
+    }
+    graph.freeze();
+}
+
+int runGraphBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 1000;
+    int queries = argc > 3 ? atoi(argv[3]) : 20;
+    if (side < 2 || queries < 1) {
+        cout << "Usage: Emergency_Services --bench-graph [grid side] [route queries]" << endl;
+        return 1;
+    }
+    Graph graph;
+    auto startTime = chrono::steady_clock::now();
+    buildGridCity(graph, side, side, 42);
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    cout << "Grid city " << side << " x " << side << ": " << graph.nodeCount() << " locations, " << graph.edgeCount()
+         << " directed roads, " << graph.memoryBytes() / (1024 * 1024) << " MB of arrays, built in " << buildMs << " ms" << endl;
+
+    vector<int> order;
+    startTime = chrono::steady_clock::now();
+    graph.bfsOrder(0, order);
+    double bfsMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    startTime = chrono::steady_clock::now();
+    graph.dfsOrder(0, order);
+    double dfsMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    cout << "BFS over " << order.size() << " locations: " << bfsMs << " ms, DFS: " << dfsMs << " ms" << endl;
+
+    mt19937 rng(7);
+    uniform_int_distribution<int> pick(0, graph.nodeCount() - 1);
+    vector<int> path;
+    long long checksum = 0;
+    startTime = chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        int from = pick(rng), to = pick(rng);
+        checksum += graph.shortestPath(from, to, &path);
+    }
+    double routeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    cout << "Dijkstra: " << queries << " random routes, " << routeMs / queries << " ms each (distance sum " << checksum << ")" << endl;
+    return 0;
+}
+
+// Sum of the roads along path, or -1 when two consecutive stops are not joined
+long long routeLength(Graph& graph, const vector<int>& path) {
+    long long total = 0;
+    for (size_t i = 1; i < path.size(); i++) {
+        int weight = graph.roadWeight(path[i - 1], path[i]);
+        if (weight == INT_MAX) return -1;
+        total += weight;
+    }
+    return total;
+}
+
+int runHierarchyBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 300;
+    int queries = argc > 3 ? atoi(argv[3]) : 200;
+    if (side < 2 || queries < 1) {
+        cout << "Usage: Emergency_Services --bench-ch [grid side] [route queries]" << endl;
+        return 1;
+    }
+    Graph graph;
+    buildGridCity(graph, side, side, 42);
+    graph.buildRouteIndex();
+    ContractionHierarchy& hierarchy = graph.routeIndex();
+    cout << "Grid city " << side << " x " << side << ": " << graph.nodeCount() << " locations; hierarchy built in "
+         << hierarchy.buildMs << " ms with " << hierarchy.shortcuts << " shortcuts, "
+         << hierarchy.memoryBytes() / 1024 << " KB" << endl;
+
+    mt19937 rng(7);
+    uniform_int_distribution<int> pick(0, graph.nodeCount() - 1);
+    vector<pair<int, int>> pairs(queries);
+    for (auto& p : pairs) p = {pick(rng), pick(rng)};
+
+    vector<int> expected(queries);
+    vector<int> path;
+    auto startTime = chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) expected[q] = graph.shortestPath(pairs[q].first, pairs[q].second, &path);
+    double dijkstraMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+
+    long long settled = 0, settledTotal = 0;
+    int mismatches = 0;
+    startTime = chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        int dist = hierarchy.query(pairs[q].first, pairs[q].second, nullptr, &settled);
+        settledTotal += settled;
+        if (dist != expected[q]) mismatches++;
+    }
+    double chMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+
+    int badPaths = 0;
+    startTime = chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        hierarchy.query(pairs[q].first, pairs[q].second, &path, nullptr);
+        bool ends = !path.empty() && path.front() == pairs[q].first && path.back() == pairs[q].second;
+        if (!ends || routeLength(graph, path) != expected[q]) badPaths++;
+    }
+    double unpackMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+
+    cout << "Dijkstra: " << dijkstraMs / queries << " ms per route" << endl;
+    cout << "Hierarchy: " << chMs * 1000 / queries << " us per route (" << settledTotal / queries << " locations settled), "
+         << unpackMs * 1000 / queries << " us with the path unpacked and checked" << endl;
+    cout << "Speedup " << dijkstraMs / chMs << "x; " << mismatches << " distance mismatches, " << badPaths << " invalid paths" << endl;
+    return mismatches == 0 && badPaths == 0 ? 0 : 1;
+}
+
+int runDispatchBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 500;
+    int stationCount = argc > 3 ? atoi(argv[3]) : 40;
+    int incidentCount = argc > 4 ? atoi(argv[4]) : 400;
+    int maxThreads = argc > 5 ? atoi(argv[5]) : (int)max(1u, thread::hardware_concurrency());
+    if (side < 2 || stationCount < 1 || incidentCount < 1 || maxThreads < 1) {
+        cout << "Usage: Emergency_Services --bench-dispatch [grid side] [stations] [incidents] [threads]" << endl;
+        return 1;
+    }
+    Graph graph;
+    buildGridCity(graph, side, side, 42);
+    mt19937 rng(11);
+    uniform_int_distribution<int> pick(0, graph.nodeCount() - 1);
+    vector<int> stations(stationCount), incidents(incidentCount);
+    for (int& station : stations) station = pick(rng);
+    for (int& incident : incidents) incident = pick(rng);
+    cout << "Grid city " << side << " x " << side << ", " << stationCount << " stations, " << incidentCount << " incidents" << endl;
+
+    // one search per incident against one search per station per incident
+    for (int station : stations) graph.addStation(graph.locationName(station));
+    SearchScratch scratch;
+    vector<double> latency(incidentCount);
+    vector<DispatchResult> expected(incidentCount);
+    for (int i = 0; i < incidentCount; i++) {
+        auto startTime = chrono::steady_clock::now();
+        expected[i] = graph.nearestStation(stations, incidents[i], scratch);
+        latency[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+    }
+    int perStationSamples = min(incidentCount, 10);
+    int mismatches = 0;
+    auto startTime = chrono::steady_clock::now();
+    for (int i = 0; i < perStationSamples; i++) {
+        int best = INT_MAX;
+        for (int station : stations) best = min(best, graph.shortestPath(station, incidents[i], nullptr));
+        if (best != expected[i].distance) mismatches++;
+    }
+    double perStationUs = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count() / perStationSamples;
+    for (const DispatchResult& result : expected) {
+        if (result.station >= 0 && routeLength(graph, result.route) != result.distance) mismatches++;
+    }
+    startTime = chrono::steady_clock::now();
+    graph.buildStationCoverage();
+    double coverageMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    startTime = chrono::steady_clock::now();
+    for (int i = 0; i < incidentCount; i++) {
+        DispatchResult covered = graph.coveredStation(incidents[i]);
+        if (covered.distance != expected[i].distance || routeLength(graph, covered.route) != covered.distance) mismatches++;
+    }
+    double lookupUs = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count() / incidentCount;
+
+    vector<double> sorted = latency;
+    sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (double us : latency) total += us;
+    cout << "Search from the incident: " << total / incidentCount << " us mean, p50 " << sorted[incidentCount / 2]
+         << " us, p99 " << sorted[min(incidentCount - 1, incidentCount * 99 / 100)] << " us per incident" << endl;
+    cout << "One Dijkstra per station: " << perStationUs << " us per incident (" << perStationSamples << " sampled)" << endl;
+    cout << "Coverage map from all stations: " << coverageMs << " ms once, then " << lookupUs << " us per incident (route checked)" << endl;
+
+    vector<DispatchResult> results;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        startTime = chrono::steady_clock::now();
+        graph.dispatchIncidents(stations, incidents, results, threads);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        for (int i = 0; i < incidentCount; i++) {
+            if (results[i].distance != expected[i].distance || results[i].station != expected[i].station) mismatches++;
+        }
+        cout << "Batch with " << threads << " thread(s): " << ms << " ms, " << incidentCount * 1000.0 / ms << " incidents/s" << endl;
+        if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2;
+    }
+    cout << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+int runUpdateBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 300;
+    int batches = argc > 3 ? atoi(argv[3]) : 200;
+    int batchSize = argc > 4 ? atoi(argv[4]) : 1000;
+    if (side < 2 || batches < 1 || batchSize < 1) {
+        cout << "Usage: Emergency_Services --bench-updates [grid side] [batches] [roads per batch]" << endl;
+        return 1;
+    }
+    Graph graph;
+    buildGridCity(graph, side, side, 42);
+    long long arcs = graph.edgeCount();
+
+    // random congestion on existing roads: each picks a location and its east or south neighbour
+    mt19937 rng(5);
+    uniform_int_distribution<int> cell(0, side - 2), weight(1, 60);
+    vector<vector<RoadUpdate>> updates(batches);
+    for (auto& batch : updates) {
+        batch.resize(batchSize);
+        for (RoadUpdate& update : batch) {
+            int x = cell(rng), y = cell(rng);
+            update.from = y * side + x;
+            update.to = (rng() & 1) ? update.from + 1 : update.from + side;
+            update.weight = weight(rng);
+        }
+    }
+    cout << "Grid city " << side << " x " << side << ", " << batches << " batches of " << batchSize << " road updates" << endl;
+
+    auto startTime = chrono::steady_clock::now();
+    graph.buildRoadIndex();
+    double indexMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    startTime = chrono::steady_clock::now();
+    long long applied = 0;
+    for (const auto& batch : updates) applied += graph.updateRoads(batch);
+    double updateNs = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count() / applied;
+    int mismatches = graph.edgeCount() != arcs ? 1 : 0;
+
+    // the old way: re-add the batch's roads and rebuild the CSR arrays
+    Graph rebuilt;
+    buildGridCity(rebuilt, side, side, 42);
+    startTime = chrono::steady_clock::now();
+    for (const RoadUpdate& update : updates[0]) rebuilt.addEdge(update.from, update.to, update.weight);
+    rebuilt.freeze();
+    double rebuildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    cout << "Road index built in " << indexMs << " ms; in-place updates " << updateNs << " ns per road, re-adding one batch and refreezing "
+         << rebuildMs << " ms" << endl;
+
+    // every update applied through addEdge instead must give the same graph
+    for (size_t b = 1; b < updates.size(); b++) {
+        for (const RoadUpdate& update : updates[b]) rebuilt.addEdge(update.from, update.to, update.weight);
+    }
+    uniform_int_distribution<int> pick(0, graph.nodeCount() - 1);
+    for (int q = 0; q < 20; q++) {
+        int from = pick(rng), to = pick(rng);
+        if (graph.shortestPath(from, to, nullptr) != rebuilt.shortestPath(from, to, nullptr)) mismatches++;
+    }
+    if (rebuilt.edgeCount() != arcs) mismatches++;
+
+    // routes searched while another thread streams the batches in again
+    int routeQueries = 20;
+    vector<pair<int, int>> pairs(routeQueries);
+    for (auto& p : pairs) p = {pick(rng), pick(rng)};
+    startTime = chrono::steady_clock::now();
+    for (auto& p : pairs) graph.shortestPath(p.first, p.second, nullptr);
+    double idleMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count() / routeQueries;
+
+    atomic<bool> done(false);
+    double streamMs = 0;
+    thread updater([&]() {
+        auto streamStart = chrono::steady_clock::now();
+        for (int round = 0; round < 5; round++) {
+            for (const auto& batch : updates) graph.updateRoads(batch);
         }
-        path.push(start);
-        while (!path.empty()) {
-            cout << path.top();
-            path.pop();
-            if (!path.empty()) cout << " -> ";
+        streamMs = chrono::duration<double, milli>(chrono::steady_clock::now() - streamStart).count();
+        done = true;
+    });
+    long long busyQueries = 0;
+    startTime = chrono::steady_clock::now();
+    while (!done || busyQueries < routeQueries) {
+        auto& p = pairs[busyQueries % routeQueries];
+        if (graph.shortestPath(p.first, p.second, nullptr) == INT_MAX) mismatches++;
+        busyQueries++;
+    }
+    double busyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count() / busyQueries;
+    updater.join();
+    cout << "Dijkstra " << idleMs << " ms per route idle, " << busyMs << " ms while " << 5 * batches << " batches streamed in ("
+         << streamMs << " ms, " << busyQueries << " routes alongside)" << endl;
+    cout << "Weights use " << graph.memoryBytes() / (1024 * 1024) << " MB of arrays in total; " << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+int runSearchBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 500;
+    int queries = argc > 3 ? atoi(argv[3]) : 50;
+    int landmarkCount = argc > 4 ? atoi(argv[4]) : 8;
+    if (side < 2 || queries < 1 || landmarkCount < 1) {
+        cout << "Usage: Emergency_Services --bench-search [grid side] [route queries] [landmarks]" << endl;
+        return 1;
+    }
+    Graph graph;
+    buildGridCity(graph, side, side, 42);
+    graph.buildLandmarks(landmarkCount);
+    cout << "Grid city " << side << " x " << side << ": " << landmarkCount << " landmarks chosen in "
+         << graph.landmarkTable().buildMs << " ms" << endl;
+
+    mt19937 rng(7);
+    uniform_int_distribution<int> pick(0, graph.nodeCount() - 1);
+    vector<pair<int, int>> pairs(queries);
+    for (auto& p : pairs) p = {pick(rng), pick(rng)};
+
+    vector<int> expected(queries);
+    int mismatches = 0;
+    vector<int> path;
+    for (RouteStrategy strategy : {ROUTE_DIJKSTRA, ROUTE_BIDIRECTIONAL, ROUTE_LANDMARKS}) {
+        RouteStats stats;
+        long long settled = 0;
+        double microseconds = 0;
+        for (int q = 0; q < queries; q++) {
+            int dist = graph.findRoute(pairs[q].first, pairs[q].second, strategy, &path, &stats);
+            settled += stats.settled;
+            microseconds += stats.microseconds;
+            if (strategy == ROUTE_DIJKSTRA) expected[q] = dist;
+            bool ends = !path.empty() && path.front() == pairs[q].first && path.back() == pairs[q].second;
+            if (dist != expected[q] || !ends || routeLength(graph, path) != dist) mismatches++;
+        }
+        cout << routeStrategyName(strategy) << ": " << settled / queries << " locations settled, "
+             << microseconds / queries / 1000 << " ms per route" << endl;
+    }
+    cout << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Push/pop throughput on a Dijkstra-like workload: pop the smallest key, push a
+// few keys up to maxWeight above it
+template <class Queue>
+double queueThroughput(Queue& queue, int maxWeight, long long operations, long long& checksum) {
+    mt19937 rng(3);
+    uniform_int_distribution<int> step(0, maxWeight);
+    queue.prepare(maxWeight);
+    for (int i = 0; i < 1000; i++) queue.push(step(rng), i);
+    auto startTime = chrono::steady_clock::now();
+    long long done = 0;
+    while (done < operations) {
+        pair<int, int> top = queue.pop();
+        checksum += top.first;
+        queue.push(top.first + step(rng), top.second);
+        if (done % 2 == 0) {    // done steps by 3, so this alternates and the queue size holds steady
+            queue.push(top.first + step(rng), top.second);
+        } else {
+            top = queue.pop();
+            checksum += top.first;
+        }
+        done += 3;
+    }
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count() / done;
+}
+
+template <class Queue>
+double queueRoutes(Graph& graph, Queue& queue, const vector<pair<int, int>>& pairs, vector<int>& distances, long long& settled) {
+    auto startTime = chrono::steady_clock::now();
+    settled = 0;
+    for (size_t q = 0; q < pairs.size(); q++) distances[q] = graph.shortestPathWith(queue, pairs[q].first, pairs[q].second, nullptr, &settled);
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count() / pairs.size();
+}
+
+int runQueueBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 500;
+    int queries = argc > 3 ? atoi(argv[3]) : 20;
+    long long operations = argc > 4 ? atoll(argv[4]) : 6000000;
+    if (side < 2 || queries < 1 || operations < 3) {
+        cout << "Usage: Emergency_Services --bench-queue [grid side] [route queries] [queue operations]" << endl;
+        return 1;
+    }
+    BinaryHeapQueue binaryHeap;
+    RadixHeap radixHeap;
+    DialQueue dial;
+    long long sums[3] = {0, 0, 0};
+    double heapNs = queueThroughput(binaryHeap, 20, operations, sums[0]);
+    double radixNs = queueThroughput(radixHeap, 20, operations, sums[1]);
+    double dialNs = queueThroughput(dial, 20, operations, sums[2]);
+    cout << "Queue operations (weights 0-20): binary heap " << heapNs << " ns, radix heap " << radixNs << " ns, Dial buckets "
+         << dialNs << " ns per push or pop" << endl;
+    int mismatches = (sums[0] != sums[1] || sums[0] != sums[2]) ? 1 : 0;
+
+    Graph graph;
+    buildGridCity(graph, side, side, 42);
+    mt19937 rng(7);
+    uniform_int_distribution<int> pick(0, graph.nodeCount() - 1);
+    vector<pair<int, int>> pairs(queries);
+    for (auto& p : pairs) p = {pick(rng), pick(rng)};
+    vector<int> expected(queries), distances(queries);
+    long long heapSettled, settled;
+    double heapMs = queueRoutes(graph, binaryHeap, pairs, expected, heapSettled);
+    // settled counts may differ slightly: ties at the destination's distance pop in any order
+    double radixMs = queueRoutes(graph, radixHeap, pairs, distances, settled);
+    if (distances != expected) mismatches++;
+    double dialMs = queueRoutes(graph, dial, pairs, distances, settled);
+    if (distances != expected) mismatches++;
+    cout << "Dijkstra on a " << side << " x " << side << " grid (" << heapSettled / queries << " locations settled per route): binary heap "
+         << heapMs << " ms, radix heap " << radixMs << " ms, Dial buckets " << dialMs << " ms per route" << endl;
+    cout << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Dispatcher-like traffic: most requests go from a few hospitals to a pool of
+// districts, some are one-off routes, and the roads change every so often
+int runCacheBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 300;
+    int requests = argc > 3 ? atoi(argv[3]) : 2000;
+    int capacity = argc > 4 ? atoi(argv[4]) : 512;
+    if (side < 2 || requests < 1 || capacity < 0) {
+        cout << "Usage: Emergency_Services --bench-cache [grid side] [requests] [cache routes]" << endl;
+        return 1;
+    }
+    Graph graph;
+    buildGridCity(graph, side, side, 42);
+    graph.cache().capacity = capacity;
+    mt19937 rng(9);
+    uniform_int_distribution<int> pick(0, graph.nodeCount() - 1), percent(0, 99), weight(1, 20);
+    vector<int> hospitals(6), districts(300);
+    for (int& hospital : hospitals) hospital = pick(rng);
+    for (int& district : districts) district = pick(rng);
+    vector<pair<int, int>> pairs(requests);
+    vector<RoadUpdate> changes;
+    for (auto& p : pairs) {
+        int roll = percent(rng);
+        if (roll < 60) p = {hospitals[rng() % 2], districts[rng() % districts.size()]};          // the busiest hospitals
+        else if (roll < 85) p = {hospitals[rng() % hospitals.size()], districts[rng() % 40]};    // hot districts
+        else p = {pick(rng), pick(rng)};
+    }
+    int changeEvery = max(1, requests / 4);
+    cout << "Grid city " << side << " x " << side << ", " << requests << " route requests, cache of " << capacity
+         << " routes, roads changed every " << changeEvery << " requests" << endl;
+
+    // the same requests and road changes with and without the cache
+    Graph plain;
+    buildGridCity(plain, side, side, 42);
+    double cachedMs = 0, plainMs = 0;
+    int mismatches = 0;
+    vector<int> path;
+    for (int r = 0; r < requests; r++) {
+        if (r > 0 && r % changeEvery == 0) {
+            int x = (int)(rng() % (side - 1)), y = (int)(rng() % (side - 1));
+            vector<RoadUpdate> batch = {{y * side + x, y * side + x + 1, weight(rng)}};
+            graph.updateRoads(batch);
+            plain.updateRoads(batch);
         }
-        cout << " | Distance: " << distance[end] << endl;
+        auto startTime = chrono::steady_clock::now();
+        int dist = graph.cachedRoute(pairs[r].first, pairs[r].second, &path, nullptr);
+        cachedMs += chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        startTime = chrono::steady_clock::now();
+        int expected = plain.shortestPath(pairs[r].first, pairs[r].second, nullptr);
+        plainMs += chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        bool ends = !path.empty() && path.front() == pairs[r].first && path.back() == pairs[r].second;
+        if (dist != expected || !ends || routeLength(graph, path) != dist) mismatches++;
     }
+    cout << "Without cache " << plainMs / requests << " ms per request, with cache " << cachedMs / requests << " ms" << endl;
+    graph.displayCacheStats();
+    cout << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
 }
 
 // CrowdControl methods
@@ -271,15 +2918,60 @@ void CrowdControl::displayCrowdQueue() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--bench-graph") {
+        return runGraphBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--bench-ch") {
+        return runHierarchyBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--bench-dispatch") {
+        return runDispatchBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--bench-updates") {
+        return runUpdateBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--bench-search") {
+        return runSearchBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--bench-queue") {
+        return runQueueBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--bench-cache") {
+        return runCacheBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--write-edges") {
+        if (argc < 4 || atoi(argv[3]) < 2) {
+            cout << "Usage: Emergency_Services --write-edges <file> <grid side>" << endl;
+            return 1;
+        }
+        return writeGridEdgeList(argv[2], atoi(argv[3]), 42) ? 0 : 1;
+    }
+
     Graph emergencyGraph;
     CrowdControl crowdControl;
 
-    emergencyGraph.addEdge("Hospital", "Fire Station", 5);
-    emergencyGraph.addEdge("Hospital", "Police Station", 3);
-    emergencyGraph.addEdge("Fire Station", "Accident Site", 8);
-    emergencyGraph.addEdge("Police Station", "Accident Site", 6);
-    emergencyGraph.addEdge("Hospital", "Accident Site", 10);
+    if (argc > 1 && string(argv[1]) == "--load") {
+        bool menu = true;
+        if (!loadRoadNetwork(emergencyGraph, argc, argv, menu)) return 1;
+        if (!menu) return 0;
+    } else {
+        emergencyGraph.addEdge("Hospital", "Fire Station", 5);
+        emergencyGraph.addEdge("Hospital", "Police Station", 3);
+        emergencyGraph.addEdge("Fire Station", "Accident Site", 8);
+        emergencyGraph.addEdge("Police Station", "Accident Site", 6);
+        emergencyGraph.addEdge("Hospital", "Accident Site", 10);
+        emergencyGraph.addStation("Hospital");
+        emergencyGraph.addStation("Fire Station");
+        emergencyGraph.addStation("Police Station");
+    }
 
     int choice;
     do {
@@ -296,7 +2988,13 @@ int main() {
         cout << "10. Display Crowd Queue" << endl;
         cout << "11. Empty Crowd Stack" << endl;
         cout << "12. Empty Crowd Queue" << endl;
-        cout << "13. Exit" << endl;
+        cout << "13. Build Fast Route Index (speeds up option 4 until the roads change)" << endl;
+        cout << "14. Register Station (Enter location units are dispatched from)" << endl;
+        cout << "15. Dispatch Nearest Unit (Enter incident location, e.g., Accident Site)" << endl;
+        cout << "16. Update Road Travel Time (Enter both locations and the new time)" << endl;
+        cout << "17. Choose Route Search Strategy (used by option 4)" << endl;
+        cout << "18. Route Cache Statistics" << endl;
+        cout << "19. Exit" << endl;
         cout << "Enter your choice: ";
         cin >> choice;
 
@@ -308,7 +3006,7 @@ int main() {
         case 2: {
             string start;
             cout << "Enter starting location (e.g., Hospital): ";
-            cin >> start;
+            getline(cin >> ws, start);
             emergencyGraph.bfs(start);
             break;
         }
@@ -316,7 +3014,7 @@ int main() {
         case 3: {
             string start;
             cout << "Enter starting location (e.g., Hospital): ";
-            cin >> start;
+            getline(cin >> ws, start);
             emergencyGraph.dfs(start);
             break;
         }
@@ -324,9 +3022,9 @@ int main() {
         case 4: {
             string start, end;
             cout << "Enter starting location (e.g., Hospital): ";
-            cin >> start;
+            getline(cin >> ws, start);
             cout << "Enter destination location (e.g., Accident Site): ";
-            cin >> end;
+            getline(cin >> ws, end);
             emergencyGraph.ambulanceRouteOptimization(start, end);
             break;
         }
@@ -372,13 +3070,82 @@ int main() {
             break;
 
         case 13:
+            emergencyGraph.buildRouteIndex();
+            cout << "Route index built in " << emergencyGraph.routeIndex().buildMs << " ms ("
+                 << emergencyGraph.routeIndex().shortcuts << " shortcuts)." << endl;
+            break;
+
+        case 14: {
+            string name;
+            cout << "Enter station location: ";
+            getline(cin >> ws, name);
+            if (emergencyGraph.addStation(name)) {
+                cout << name << " registered as a station (" << emergencyGraph.stationList().size() << " in total)." << endl;
+            } else {
+                cout << "Unknown location: " << name << endl;
+            }
+            break;
+        }
+
+        case 15: {
+            string incident;
+            cout << "Enter incident location (e.g., Accident Site): ";
+            getline(cin >> ws, incident);
+            emergencyGraph.dispatchUnit(incident);
+            break;
+        }
+
+        case 16: {
+            string u, v;
+            int weight;
+            cout << "Enter first location: ";
+            getline(cin >> ws, u);
+            cout << "Enter second location: ";
+            getline(cin >> ws, v);
+            cout << "Enter new travel time: ";
+            cin >> weight;
+            if (emergencyGraph.updateRoad(u, v, weight)) {
+                cout << "Road " << u << " - " << v << " now takes " << weight << "." << endl;
+            } else {
+                cout << "No road between " << u << " and " << v << " (or negative time)." << endl;
+            }
+            break;
+        }
+
+        case 17: {
+            int strategy;
+            cout << "1. Automatic  2. Dijkstra  3. Bidirectional Dijkstra  4. Landmark A*  5. Contraction Hierarchy" << endl;
+            cout << "Enter strategy: ";
+            cin >> strategy;
+            if (strategy < 1 || strategy > 5) {
+                cout << "Invalid strategy!" << endl;
+                break;
+            }
+            emergencyGraph.routeStrategy = (RouteStrategy)(strategy - 1);
+            if (emergencyGraph.routeStrategy == ROUTE_LANDMARKS && !emergencyGraph.hasLandmarks()) {
+                emergencyGraph.buildLandmarks(8);
+                cout << "Landmarks chosen in " << emergencyGraph.landmarkTable().buildMs << " ms." << endl;
+            }
+            if (emergencyGraph.routeStrategy == ROUTE_HIERARCHY && !emergencyGraph.hasRouteIndex()) {
+                emergencyGraph.buildRouteIndex();
+                cout << "Route index built in " << emergencyGraph.routeIndex().buildMs << " ms." << endl;
+            }
+            cout << "Routes now use " << routeStrategyName(emergencyGraph.routeStrategy) << " search." << endl;
+            break;
+        }
+
+        case 18:
+            emergencyGraph.displayCacheStats();
+            break;
+
+        case 19:
             cout << "Exiting Emergency Services System." << endl;
             break;
 
         default:
             cout << "Invalid choice!" << endl;
         }
-    } while (choice != 13);
+    } while (choice != 19);
 
     return 0;
 }
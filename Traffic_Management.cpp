@@ -1,390 +1,4969 @@
 #include <iostream>
 #include <fstream> // For file handling
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstdio>
+#include <cstring>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 using namespace std;
 
+// When set, per-vehicle console messages are suppressed (used by the batch driver)
+bool quietMode = false;
+
+enum VehicleClass : uint8_t { TRUCK, CAR, BIKE, INVALID_VEHICLE };
+
+const string laneTypes[3] = {"Truck", "Car", "Bike"};
+
+VehicleClass parseVehicleClass(const string& type) {
+    for (int i = 0; i < 3; i++) {
+        if (laneTypes[i] == type) return (VehicleClass)i;
+    }
+    return INVALID_VEHICLE;
+}
+
+// Snapshot files are a fixed header followed by a payload of plain native-endian
+// records, written in the same order they are read back. The header carries a
+// version and a checksum of the payload so a stale or torn file is refused.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;          // what the payload holds, see SnapshotKind
+    uint64_t payloadBytes;
+    uint64_t checksum;
+};
+
+enum SnapshotKind : uint32_t { ROAD_SNAPSHOT = 1, GRID_SNAPSHOT = 2 };
+
+const char snapshotMagic[8] = {'T', 'M', 'S', 'N', 'A', 'P', '\r', '\n'};
+const uint32_t snapshotVersion = 1;
+
+// FNV-1a over 8-byte words (then the leftover bytes); fast enough to run on every save and restore
+uint64_t snapshotChecksum(const char* data, size_t bytes) {
+    uint64_t hash = 1469598103934665603ULL;
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < bytes; i++) hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    return hash;
+}
+
+// Appends a snapshot to a caller-owned buffer, so the buffer's capacity is reused
+// from one snapshot to the next. seal() fills in the header once the payload is done.
+class SnapshotWriter {
+    vector<char>& buffer;
+
+public:
+    SnapshotWriter(vector<char>& buffer, SnapshotKind kind) : buffer(buffer) {
+        SnapshotHeader header;
+        memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+        header.version = snapshotVersion;
+        header.kind = kind;
+        header.payloadBytes = 0;
+        header.checksum = 0;
+        buffer.clear();
+        putBytes(&header, sizeof(header));
+    }
+
+    void putBytes(const void* data, size_t bytes) {
+        size_t at = buffer.size();
+        buffer.resize(at + bytes);
+        if (bytes > 0) memcpy(&buffer[at], data, bytes);
+    }
+
+    template <class T>
+    void put(const T& value) {
+        putBytes(&value, sizeof(T));
+    }
+
+    // Reserves room for count records and returns where to copy them (not necessarily aligned)
+    template <class T>
+    char* putArray(size_t count) {
+        put((uint64_t)count);
+        size_t at = buffer.size();
+        buffer.resize(at + count * sizeof(T));
+        return buffer.data() + at;
+    }
+
+    void putString(const string& text) {
+        put((uint32_t)text.size());
+        putBytes(text.data(), text.size());
+    }
+
+    static void seal(vector<char>& buffer) {
+        SnapshotHeader header;
+        memcpy(&header, buffer.data(), sizeof(header));
+        header.payloadBytes = buffer.size() - sizeof(header);
+        header.checksum = snapshotChecksum(buffer.data() + sizeof(header), header.payloadBytes);
+        memcpy(buffer.data(), &header, sizeof(header));
+    }
+};
+
+// Reads a snapshot in place (usually straight out of a memory-mapped file).
+// Every read is bounds-checked; after the first failure ok() stays false and
+// reads return zeroes, so loaders can check once at the end of a section.
+class SnapshotReader {
+    const char* data;
+    size_t size;
+    size_t at;
+    bool good;
+
+public:
+    SnapshotKind kind;
+
+    SnapshotReader(const char* data, size_t size) {
+        this->data = data;
+        this->size = size;
+        at = 0;
+        good = false;
+        kind = ROAD_SNAPSHOT;
+    }
+
+    // Checks the magic, version and checksum; returns a message, or "" when the file is usable
+    string open() {
+        SnapshotHeader header;
+        if (size < sizeof(header)) return "file is too short to be a snapshot";
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0) return "not a traffic snapshot";
+        if (header.version != snapshotVersion) {
+            return "snapshot version " + to_string(header.version) + " (expected " + to_string(snapshotVersion) + ")";
+        }
+        if (header.payloadBytes != size - sizeof(header)) return "snapshot is truncated";
+        if (header.checksum != snapshotChecksum(data + sizeof(header), header.payloadBytes)) return "snapshot checksum mismatch";
+        kind = (SnapshotKind)header.kind;
+        at = sizeof(header);
+        good = true;
+        return "";
+    }
+
+    bool ok() {
+        return good;
+    }
+
+    const char* getBytes(size_t bytes) {
+        if (!good || bytes > size - at) {
+            good = false;
+            return nullptr;
+        }
+        const char* result = data + at;
+        at += bytes;
+        return result;
+    }
+
+    template <class T>
+    T get() {
+        T value = T();
+        const char* bytes = getBytes(sizeof(T));
+        if (bytes != nullptr) memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    // Returns the records written by putArray (possibly unaligned, so copy them out with memcpy)
+    template <class T>
+    const char* getArray(size_t& count) {
+        uint64_t stored = get<uint64_t>();
+        if (stored > (size - at) / sizeof(T)) {
+            good = false;
+            stored = 0;
+        }
+        count = (size_t)stored;
+        return getBytes(count * sizeof(T));
+    }
+
+    string getString() {
+        uint32_t length = get<uint32_t>();
+        const char* bytes = getBytes(length);
+        return bytes != nullptr ? string(bytes, length) : string();
+    }
+
+    bool AtEnd() {
+        return good && at == size;
+    }
+};
+
+// Vehicle IDs are 64-bit numbers. A plate made only of digits is its own ID;
+// any other plate is interned here and gets a dense index with the top bit set.
+class PlateRegistry {
+    unordered_map<string, uint64_t> ids;
+    vector<string> plates;
+    mutex lock;
+
+public:
+    static const uint64_t internedBit = 1ULL << 63;
+
+    static bool isNumericPlate(const string& plate) {
+        if (plate.empty() || plate.size() > 18 || (plate[0] == '0' && plate.size() > 1)) return false;
+        for (char c : plate) {
+            if (c < '0' || c > '9') return false;
+        }
+        return true;
+    }
+
+    uint64_t intern(const string& plate) {
+        if (isNumericPlate(plate)) return strtoull(plate.c_str(), nullptr, 10);
+        lock_guard<mutex> guard(lock);
+        auto found = ids.find(plate);
+        if (found != ids.end()) return found->second;
+        uint64_t id = internedBit | plates.size();
+        ids[plate] = id;
+        plates.push_back(plate);
+        return id;
+    }
+
+    // Like intern(), but never adds a plate; false when the plate was never seen
+    bool find(const string& plate, uint64_t& id) {
+        if (isNumericPlate(plate)) {
+            id = strtoull(plate.c_str(), nullptr, 10);
+            return true;
+        }
+        lock_guard<mutex> guard(lock);
+        auto found = ids.find(plate);
+        if (found == ids.end()) return false;
+        id = found->second;
+        return true;
+    }
+
+    // Same text as plateOf(), appended to out without building a temporary string
+    void appendPlate(uint64_t id, string& out) {
+        if (!(id & internedBit)) {
+            char digits[24];
+            int length = 0;
+            do {
+                digits[length++] = (char)('0' + id % 10);
+                id /= 10;
+            } while (id > 0);
+            while (length > 0) out.push_back(digits[--length]);
+            return;
+        }
+        lock_guard<mutex> guard(lock);
+        uint64_t index = id & ~internedBit;
+        out.append(index < plates.size() ? plates[index] : "?");
+    }
+
+    string plateOf(uint64_t id) {
+        if (!(id & internedBit)) return to_string(id);
+        lock_guard<mutex> guard(lock);
+        uint64_t index = id & ~internedBit;
+        return index < plates.size() ? plates[index] : "?";
+    }
+
+    size_t Interned() {
+        lock_guard<mutex> guard(lock);
+        return plates.size();
+    }
+
+    void save(SnapshotWriter& out) {
+        lock_guard<mutex> guard(lock);
+        out.put((uint64_t)plates.size());
+        for (const string& plate : plates) out.putString(plate);
+    }
+
+    // Replaces every interned plate, so IDs stored in the same snapshot map back to the same plates
+    bool load(SnapshotReader& in) {
+        uint64_t count = in.get<uint64_t>();
+        vector<string> loaded;
+        for (uint64_t i = 0; i < count && in.ok(); i++) loaded.push_back(in.getString());
+        if (!in.ok()) return false;
+        lock_guard<mutex> guard(lock);
+        plates.swap(loaded);
+        ids.clear();
+        for (size_t i = 0; i < plates.size(); i++) ids[plates[i]] = internedBit | i;
+        return true;
+    }
+};
+
+PlateRegistry plateRegistry;
+
+// Collects the IDs of vehicles that passed a signal and appends them to the log
+// file from a background thread. A dequeue only appends the 8-byte ID to its own
+// thread's buffer, with no lock and no formatting; a full buffer (or the first
+// log after each flush interval) is handed to the flush thread under the lock,
+// and the flush thread turns the IDs into text. The file is opened on the first
+// hand-over and kept open until the logger is destroyed. IDs handed over after
+// shutdown() are written straight away by the thread that hands them over.
+class PassedVehicleLogger {
+    static const size_t handOverRecords = 1024;
+
+    // One producer thread's IDs not yet handed over; what is left goes to the
+    // logger when the thread exits
+    struct ProducerBuffer {
+        PassedVehicleLogger* owner = nullptr;
+        vector<uint64_t> ids;
+        uint64_t epoch = 0;
+        ~ProducerBuffer() {
+            if (owner != nullptr && !ids.empty()) owner->handOver(*this);
+        }
+    };
+
+    string fileName;
+    ofstream file;
+    vector<vector<uint64_t>> pending;  // handed over, waiting for the flush thread
+    vector<vector<uint64_t>> spare;    // emptied buffers, given back to producers
+    size_t pendingRecords;
+    string writeBuffer;   // text of one flush, used by whoever holds writeLock
+    mutex bufferLock;
+    mutex writeLock;
+    condition_variable wakeUp;
+    thread flusher;
+    atomic<bool> enabled;
+    atomic<uint64_t> epoch;            // bumped by every flush; producers hand over when it moves
+    bool started;
+    bool stopping;
+    bool closed;
+    bool failed;
+    int flushIntervalMs;
+    size_t flushBytes;    // counted as 8 bytes per record handed over
+
+    void start() {
+        file.open(fileName, ios::app | ios::binary);
+        if (!file.is_open()) {
+            failed = true;
+            cout << "Error: Unable to open the file for logging vehicle IDs." << endl;
+            return;
+        }
+        writeBuffer.reserve(flushBytes * 2);
+        started = true;
+        flusher = thread(&PassedVehicleLogger::flushLoop, this);
+    }
+
+    void flushLoop() {
+        unique_lock<mutex> lock(bufferLock);
+        while (!stopping) {
+            wakeUp.wait_for(lock, chrono::milliseconds(flushIntervalMs), [this] {
+                return stopping || pendingRecords * sizeof(uint64_t) >= flushBytes;
+            });
+            lock.unlock();
+            writePending();
+            lock.lock();
+        }
+    }
+
+    ProducerBuffer& localBuffer() {
+        static thread_local ProducerBuffer buffer;
+        if (buffer.owner == nullptr) {
+            buffer.owner = this;
+            buffer.ids.reserve(handOverRecords);
+            buffer.epoch = ~0ULL;   // the first log hands over at once, which opens the file
+        }
+        return buffer;
+    }
+
+    // Swaps the producer's IDs for an empty buffer; the only lock on the producer side
+    void handOver(ProducerBuffer& buffer) {
+        bool wake, writeNow;
+        {
+            lock_guard<mutex> lock(bufferLock);
+            buffer.epoch = epoch.load(memory_order_relaxed);
+            if (closed) {
+                buffer.ids.clear();
+                return;
+            }
+            if (!started) {
+                if (failed || stopping) {
+                    buffer.ids.clear();
+                    return;
+                }
+                start();
+                if (failed) {
+                    buffer.ids.clear();
+                    return;
+                }
+            }
+            pendingRecords += buffer.ids.size();
+            pending.emplace_back();
+            pending.back().swap(buffer.ids);
+            if (!spare.empty()) {
+                buffer.ids.swap(spare.back());
+                spare.pop_back();
+            }
+            wake = pendingRecords * sizeof(uint64_t) >= flushBytes;
+            writeNow = stopping;   // the flush thread is gone (or going), so nobody else will
+        }
+        if (buffer.ids.capacity() < handOverRecords) buffer.ids.reserve(handOverRecords);
+        if (writeNow) writePending();
+        else if (wake) wakeUp.notify_one();
+    }
+
+    // Writes everything handed over so far; IDs still in producers' buffers stay there
+    void writePending() {
+        lock_guard<mutex> writer(writeLock);
+        vector<vector<uint64_t>> batch;
+        {
+            lock_guard<mutex> lock(bufferLock);
+            epoch.fetch_add(1, memory_order_relaxed);
+            if (!started || pending.empty()) return;
+            batch.swap(pending);
+            pendingRecords = 0;
+        }
+        writeBuffer.clear();
+        for (const vector<uint64_t>& ids : batch) {
+            for (uint64_t id : ids) {
+                plateRegistry.appendPlate(id, writeBuffer);
+                writeBuffer.push_back('\n');
+            }
+        }
+        file.write(writeBuffer.data(), writeBuffer.size());
+        file.flush();
+        lock_guard<mutex> lock(bufferLock);
+        for (vector<uint64_t>& ids : batch) {
+            if (spare.size() >= 64) break;
+            ids.clear();
+            spare.push_back(std::move(ids));
+        }
+    }
+
+    // Stops the flush thread and writes what it left behind; does nothing the second time
+    void stop() {
+        {
+            lock_guard<mutex> lock(bufferLock);
+            if (stopping) return;
+            stopping = true;
+        }
+        wakeUp.notify_one();
+        if (flusher.joinable()) flusher.join();
+        writePending();
+    }
+
+public:
+    PassedVehicleLogger(const string& fileName, int flushIntervalMs = 200, size_t flushBytes = 64 * 1024) {
+        this->fileName = fileName;
+        this->flushIntervalMs = flushIntervalMs;
+        this->flushBytes = flushBytes;
+        pendingRecords = 0;
+        started = stopping = closed = failed = false;
+        enabled = true;
+        epoch = 0;
+    }
+
+    // Benchmarks turn logging off so they time the lanes alone
+    void setEnabled(bool value) {
+        enabled = value;
+    }
+
+    // Takes effect immediately; the flush thread re-reads both values on every wake-up
+    void configure(int intervalMs, size_t bytes) {
+        lock_guard<mutex> lock(bufferLock);
+        if (intervalMs > 0) flushIntervalMs = intervalMs;
+        if (bytes > 0) flushBytes = bytes;
+    }
+
+    void log(uint64_t id) {
+        if (!enabled.load(memory_order_relaxed)) return;
+        ProducerBuffer& buffer = localBuffer();
+        buffer.ids.push_back(id);
+        if (buffer.ids.size() >= handOverRecords || buffer.epoch != epoch.load(memory_order_relaxed)) handOver(buffer);
+    }
+
+    // Writes everything handed over so far, after handing over the calling
+    // thread's own IDs; safe to call from any thread
+    void flush() {
+        ProducerBuffer& own = localBuffer();
+        if (!own.ids.empty()) handOver(own);
+        writePending();
+    }
+
+    // Hands over the calling thread's IDs and writes everything out. Worker
+    // threads that exit later still get their IDs written when they hand over.
+    void shutdown() {
+        ProducerBuffer& own = localBuffer();
+        if (!own.ids.empty()) handOver(own);
+        stop();
+    }
+
+    // Runs after the main thread's thread_local buffer has been destroyed (it
+    // handed its IDs over then), so this must not call localBuffer()
+    ~PassedVehicleLogger() {
+        stop();
+        lock_guard<mutex> writer(writeLock);
+        {
+            lock_guard<mutex> lock(bufferLock);
+            closed = true;
+        }
+        if (file.is_open()) file.close();
+    }
+};
+
+PassedVehicleLogger passedLog("passed_vehicles.txt");
+
+// Columnar passed-vehicle log: one record per vehicle that passed a signal, with
+// the time, wait, intersection, class and lane the text log above leaves out.
+// Records are packed into blocks of up to passBlockRecords. Each block is a fixed
+// header (record count, per-class counts and the min/max of every numeric column)
+// followed by its columns one after another:
+//   time          zigzag varint of the change from the previous record (the first from minTime)
+//   wait          varint seconds
+//   intersection  zigzag varint of the change from the previous record (the first from minIntersection)
+//   class, lane   one byte per record each
+// A query reads the headers first, so blocks outside its filters are never touched,
+// and then decodes only the columns it needs from the rest.
+struct PassRecord {
+    uint64_t time;          // simulated seconds when the vehicle passed
+    uint32_t wait;          // seconds it spent in the lane
+    uint32_t intersection;
+    uint8_t vehicleClass;
+    uint8_t lane;
+};
+
+struct PassLogFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockRecords;
+};
+
+struct PassBlockHeader {
+    char magic[4];
+    uint32_t records;
+    uint32_t columnBytes[3];  // varint bytes of the time, wait and intersection columns
+    uint32_t classCounts[3];  // records per VehicleClass
+    uint32_t minWait, maxWait;
+    uint32_t minIntersection, maxIntersection;
+    uint64_t minTime, maxTime;
+    uint64_t checksum;        // snapshotChecksum() of the columns
+};
+
+const char passLogMagic[8] = {'T', 'M', 'P', 'A', 'S', 'S', '\r', '\n'};
+const char passBlockMagic[4] = {'P', 'B', 'L', 'K'};
+const uint32_t passLogVersion = 1;
+const uint32_t passBlockRecords = 4096;
+
+void putVarint(vector<char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+// Reads one varint, never past end; returns false on a truncated or overlong value
+bool getVarint(const unsigned char*& in, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7) {
+        unsigned char byte = *in++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Encodes records (at most passBlockRecords) as one block, replacing out's contents
+void encodePassBlock(const vector<PassRecord>& records, vector<char>& out) {
+    PassBlockHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, passBlockMagic, sizeof(header.magic));
+    header.records = (uint32_t)records.size();
+    header.minTime = header.maxTime = records[0].time;
+    header.minWait = header.maxWait = records[0].wait;
+    header.minIntersection = header.maxIntersection = records[0].intersection;
+    for (const PassRecord& record : records) {
+        header.minTime = min(header.minTime, record.time);
+        header.maxTime = max(header.maxTime, record.time);
+        header.minWait = min(header.minWait, record.wait);
+        header.maxWait = max(header.maxWait, record.wait);
+        header.minIntersection = min(header.minIntersection, record.intersection);
+        header.maxIntersection = max(header.maxIntersection, record.intersection);
+        if (record.vehicleClass < 3) header.classCounts[record.vehicleClass]++;
+    }
+
+    out.assign(sizeof(header), 0);
+    size_t start = out.size();
+    uint64_t previous = header.minTime;
+    for (const PassRecord& record : records) {
+        putVarint(out, zigzag((int64_t)(record.time - previous)));
+        previous = record.time;
+    }
+    header.columnBytes[0] = (uint32_t)(out.size() - start);
+    start = out.size();
+    for (const PassRecord& record : records) putVarint(out, record.wait);
+    header.columnBytes[1] = (uint32_t)(out.size() - start);
+    start = out.size();
+    previous = header.minIntersection;
+    for (const PassRecord& record : records) {
+        putVarint(out, zigzag((int64_t)record.intersection - (int64_t)previous));
+        previous = record.intersection;
+    }
+    header.columnBytes[2] = (uint32_t)(out.size() - start);
+    for (const PassRecord& record : records) out.push_back((char)record.vehicleClass);
+    for (const PassRecord& record : records) out.push_back((char)record.lane);
+
+    header.checksum = snapshotChecksum(out.data() + sizeof(header), out.size() - sizeof(header));
+    memcpy(out.data(), &header, sizeof(header));
+}
+
+// The log file; blocks are appended whole under a lock, so several writers
+// (one per thread) can share it. An existing log is appended to.
+class PassLogFile {
+    ofstream file;
+    string path;
+    mutex lock;
+
+public:
+    long long blocks = 0;
+    long long records = 0;
+    long long bytes = 0;
+    bool failed = false;
+
+    bool open(const string& path) {
+        this->path = path;
+        ifstream existing(path, ios::binary | ios::ate);
+        long long existingBytes = existing.is_open() ? (long long)existing.tellg() : 0;
+        bool fresh = existingBytes <= 0;
+        PassLogFileHeader header;
+        if (!fresh) {
+            // A file too short to hold a header is a torn write, not an empty log;
+            // appending a new header after it would leave garbage at the front
+            existing.seekg(0);
+            if (existingBytes < (long long)sizeof(header) || !existing.read((char*)&header, sizeof(header))) {
+                cout << "Error: " << path << " is shorter than a passed-vehicle log header" << endl;
+                return false;
+            }
+            if (memcmp(header.magic, passLogMagic, sizeof(header.magic)) != 0 || header.version != passLogVersion) {
+                cout << "Error: " << path << " exists and is not a passed-vehicle log" << endl;
+                return false;
+            }
+        }
+        existing.close();
+        file.open(path, ios::binary | ios::app);
+        if (!file.is_open()) {
+            cout << "Error: Unable to open " << path << endl;
+            return false;
+        }
+        if (fresh) {
+            memcpy(header.magic, passLogMagic, sizeof(header.magic));
+            header.version = passLogVersion;
+            header.blockRecords = passBlockRecords;
+            file.write((const char*)&header, sizeof(header));
+            file.flush();
+            if (!file.good()) {
+                cout << "Error: Unable to write to " << path << endl;
+                file.close();
+                return false;
+            }
+            bytes += sizeof(header);
+        }
+        return true;
+    }
+
+    // Returns false once a write has failed; the first failure is reported and
+    // later blocks are dropped rather than written after a partial one
+    bool append(const vector<char>& block, size_t count) {
+        lock_guard<mutex> guard(lock);
+        if (failed) return false;
+        file.write(block.data(), block.size());
+        if (!file.good()) {
+            cout << "Error: Unable to write to " << path << endl;
+            failed = true;
+            return false;
+        }
+        blocks++;
+        records += count;
+        bytes += block.size();
+        return true;
+    }
+
+    bool close() {
+        if (file.is_open()) {
+            file.close();
+            if (file.fail() && !failed) {
+                cout << "Error: Unable to write to " << path << endl;
+                failed = true;
+            }
+        }
+        return !failed;
+    }
+};
+
+// Buffers one thread's records and encodes them a block at a time, so the
+// shared file is only locked once per passBlockRecords vehicles
+class PassLogWriter {
+    PassLogFile* file;
+    vector<PassRecord> pending;
+    vector<char> block;
+
+public:
+    PassLogWriter(PassLogFile* file = nullptr) {
+        this->file = file;
+        pending.reserve(passBlockRecords);
+    }
+
+    PassLogWriter(const PassLogWriter&) = delete;
+    PassLogWriter& operator=(const PassLogWriter&) = delete;
+
+    void record(const PassRecord& record) {
+        pending.push_back(record);
+        if (pending.size() == passBlockRecords) flush();
+    }
+
+    void flush() {
+        if (pending.empty() || file == nullptr) return;
+        encodePassBlock(pending, block);
+        file->append(block, pending.size());
+        pending.clear();
+    }
+
+    ~PassLogWriter() {
+        flush();
+    }
+};
+
+// Closes the log (every writer must already be flushed) and reports on it
+void printPassLogSummary(PassLogFile& file, const string& path) {
+    file.close();
+    if (file.failed) cout << "WARNING: pass log writes to " << path << " failed; the log is incomplete" << endl;
+    cout << "Pass log: " << file.records << " vehicles in " << file.blocks << " blocks appended to " << path << " ("
+         << (file.records > 0 ? (double)file.bytes / file.records : 0) << " bytes per vehicle)" << endl;
+}
+
+// 16 bytes: the ID, the second the vehicle joined its lane and its class
 class Vehicles{
     public:
-    string id;
-    string type;
+    uint64_t id;
+    // Low 32 bits of the road clock when the vehicle joined its lane, which keeps the
+    // record at 16 bytes. waitedAt() subtracts modulo 2^32, so waits stay right at any
+    // clock value as long as one wait is under 2^32 seconds (about 136 years).
+    uint32_t arrivalTime;
+    VehicleClass type;
+
+    Vehicles(){
+        id = 0;
+        arrivalTime = 0;
+        type = INVALID_VEHICLE;
+    }
+
+    Vehicles(string id, string type){
+        this->id = plateRegistry.intern(id);
+        this->type = parseVehicleClass(type);
+        arrivalTime = 0;
+    }
+
+    Vehicles(uint64_t id, VehicleClass type, uint32_t arrivalTime = 0){
+        this->id = id;
+        this->type = type;
+        this->arrivalTime = arrivalTime;
+    }
+
+    string Plate(){
+        return plateRegistry.plateOf(id);
+    }
+
+    // Seconds spent in the lane by the given clock
+    uint32_t waitedAt(long long clock) const {
+        return (uint32_t)clock - arrivalTime;
+    }
+
+    void displayInfo(){
+        cout<<" <-- ID: "<<Plate();
+        // cout<<" Type: "<<type;
+        // cout << "Number: ";
+        // cout << "Number: ";
+    }
+    
+};
+
+static_assert(sizeof(Vehicles) == 16, "Vehicles should stay a compact 16-byte record");
+
+// What a lane display shows: the vehicle counts only, the first or last count
+// vehicles, or page number page (from 0) of count vehicles
+enum LaneView { VIEW_SUMMARY, VIEW_HEAD, VIEW_TAIL, VIEW_PAGE };
+
+struct DisplayOptions {
+    LaneView view = VIEW_HEAD;
+    size_t count = 20;
+    size_t page = 0;
+};
+
+// Formats a whole display into one buffer and writes it to the console in a
+// single call. The buffer is reserved up front and kept between displays.
+class LaneRenderer {
+    string buffer;
+
+public:
+    LaneRenderer(size_t reserve = 64 * 1024) {
+        buffer.reserve(reserve);
+    }
+
+    LaneRenderer& text(const char* value) {
+        buffer.append(value);
+        return *this;
+    }
+
+    LaneRenderer& text(const string& value) {
+        buffer.append(value);
+        return *this;
+    }
+
+    LaneRenderer& number(unsigned long long value) {
+        char digits[24];
+        int length = 0;
+        do {
+            digits[length++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (length > 0) buffer.push_back(digits[--length]);
+        return *this;
+    }
+
+    // Same text as Vehicles::displayInfo()
+    LaneRenderer& vehicle(const Vehicles& vehicle) {
+        buffer.append(" <-- ID: ");
+        plateRegistry.appendPlate(vehicle.id, buffer);
+        return *this;
+    }
+
+    void write() {
+        cout.write(buffer.data(), buffer.size());
+        cout.flush();
+        buffer.clear();
+    }
+};
+
+LaneRenderer consoleRenderer;
+
+// Open-addressing hash map from vehicle ID to where a lane keeps that vehicle (a
+// node address or a ring sequence number). Linear probing over power-of-two
+// arrays, with backward-shift deletion so there are no tombstones to clean up.
+// IDs are expected to be unique within a lane; with duplicates the index follows
+// the most recent one.
+class VehicleIndex {
+    vector<uint64_t> keys;
+    vector<uint64_t> values;
+    size_t mask;
+    size_t count;
+    int shift;
+
+    static constexpr uint64_t emptyKey = ~0ULL;
+
+    size_t slotOf(uint64_t id) {
+        return (size_t)((id * 0x9E3779B97F4A7C15ULL) >> shift); // Fibonacci hashing
+    }
+
+    void rehash(size_t slots) {
+        vector<uint64_t> oldKeys, oldValues;
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        keys.assign(slots, emptyKey);
+        values.assign(slots, 0);
+        mask = slots - 1;
+        shift = 64 - __builtin_ctzll(slots);
+        count = 0;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] != emptyKey) put(oldKeys[i], oldValues[i]);
+        }
+    }
+
+public:
+    VehicleIndex() {
+        mask = count = 0;
+        shift = 64;
+    }
+
+    size_t Size() {
+        return count;
+    }
+
+    void clear() {
+        keys.clear();
+        values.clear();
+        mask = count = 0;
+        shift = 64;
+    }
+
+    void put(uint64_t id, uint64_t value) {
+        if ((count + 1) * 4 > keys.size() * 3) rehash(keys.empty() ? 16 : keys.size() * 2); // at most 75% full
+        size_t slot = slotOf(id);
+        while (keys[slot] != emptyKey && keys[slot] != id) slot = (slot + 1) & mask;
+        if (keys[slot] == emptyKey) count++;
+        keys[slot] = id;
+        values[slot] = value;
+    }
+
+    bool get(uint64_t id, uint64_t& value) {
+        if (count == 0) return false;
+        for (size_t slot = slotOf(id); keys[slot] != emptyKey; slot = (slot + 1) & mask) {
+            if (keys[slot] == id) {
+                value = values[slot];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Removes id only while it still maps to value (a newer duplicate keeps its entry)
+    bool erase(uint64_t id, uint64_t value) {
+        if (count == 0) return false;
+        size_t slot = slotOf(id);
+        while (keys[slot] != id) {
+            if (keys[slot] == emptyKey) return false;
+            slot = (slot + 1) & mask;
+        }
+        if (values[slot] != value) return false;
+        // pull later entries of the probe run back so lookups never stop early
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & mask; keys[next] != emptyKey; next = (next + 1) & mask) {
+            size_t home = slotOf(keys[next]);
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                keys[hole] = keys[next];
+                values[hole] = values[next];
+                hole = next;
+            }
+        }
+        keys[hole] = emptyKey;
+        count--;
+        return true;
+    }
+};
+
+class Node{
+    public:
+    Vehicles data;
+    Node* next;
+    Node* prev; // lets an indexed lane unlink any node in O(1)
+
+    Node(){
+        data = Vehicles();
+        next = prev = nullptr;
+    }
+
+    Node(Vehicles data){
+        this->data = data;
+        next = prev = nullptr;
+    }
+};
+
+// Hands out Nodes from chunks allocated in bulk and keeps released nodes on a
+// free list, so a busy lane stops calling new/delete once it has warmed up.
+// Each chunk is twice the size of the previous one, up to maxChunkSize.
+class NodePool {
+    vector<Node*> chunks;
+    Node* freeList;
+    int nextChunkSize;
+    long long inUse;
+    long long highWater;
+    long long capacity;
+    long long allocations; // heap allocations made for nodes, for the lane benchmark
+    bool pooled;
+
+    static const int maxChunkSize = 65536;
+
+    void grow() {
+        Node* chunk = new Node[nextChunkSize];
+        allocations++;
+        for (int i = 0; i < nextChunkSize; i++) {
+            chunk[i].next = freeList;
+            freeList = &chunk[i];
+        }
+        chunks.push_back(chunk);
+        capacity += nextChunkSize;
+        if (nextChunkSize < maxChunkSize) nextChunkSize *= 2;
+    }
+
+public:
+    // pooled = false gives the old per-node new/delete behaviour (benchmark baseline)
+    NodePool(int firstChunkSize = 64, bool pooled = true) {
+        freeList = nullptr;
+        nextChunkSize = firstChunkSize > 0 ? firstChunkSize : 1;
+        inUse = highWater = capacity = allocations = 0;
+        this->pooled = pooled;
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    Node* acquire(const Vehicles& data) {
+        Node* node;
+        if (!pooled) {
+            node = new Node(data);
+            allocations++;
+        } else {
+            if (freeList == nullptr) grow();
+            node = freeList;
+            freeList = node->next;
+            node->data = data;
+            node->next = node->prev = nullptr;
+        }
+        if (++inUse > highWater) highWater = inUse;
+        return node;
+    }
+
+    void release(Node* node) {
+        inUse--;
+        if (!pooled) {
+            delete node;
+            return;
+        }
+        node->next = freeList;
+        freeList = node;
+    }
+
+    long long InUse() { return inUse; }
+    long long HighWaterMark() { return highWater; }
+    long long Capacity() { return capacity; }
+    long long Allocations() { return allocations; }
+
+    ~NodePool() {
+        for (Node* chunk : chunks) delete[] chunk;
+    }
+};
+
+class ListQue{
+    Node* front;
+    Node* rear;
+    int count;
+    NodePool pool;
+    VehicleIndex index; // ID -> node address, kept only when indexed
+    bool indexed;
+    // Last vehicle VisitRange showed, so paging through an unchanged lane walks
+    // only the page itself. Anything that removes or reorders vehicles bumps
+    // reorders, which retires the cursor; appending does not move positions.
+    Node* cursor;
+    size_t cursorAt;
+    unsigned long long reorders, cursorReorders;
+
+    // Takes node out of the list and returns it to the pool
+    void unlink(Node* node){
+        reorders++;
+        if (node->prev != nullptr) node->prev->next = node->next;
+        else front = node->next;
+        if (node->next != nullptr) node->next->prev = node->prev;
+        else rear = node->prev;
+        if (indexed) index.erase(node->data.id, (uint64_t)(uintptr_t)node);
+        pool.release(node);
+        count--;
+    }
+
+    Node* findNode(uint64_t id){
+        uint64_t address;
+        if (!indexed || !index.get(id, address)) return nullptr;
+        return (Node*)(uintptr_t)address;
+    }
+
+    public:
+    static const int InputMode = 1;
+    static const char* Name() { return "Linked List"; }
+
+    ListQue(bool pooled = true) : pool(64, pooled) {
+        front = nullptr;
+        rear = nullptr;
+        count = 0;
+        indexed = false;
+        cursor = nullptr;
+        cursorAt = 0;
+        reorders = cursorReorders = 0;
+    }
+
+    // Starts keeping the ID index (covers vehicles already queued)
+    void EnableIndex(){
+        if (indexed) return;
+        indexed = true;
+        for (Node* node = front; node != nullptr; node = node->next) index.put(node->data.id, (uint64_t)(uintptr_t)node);
+    }
+
+    bool Enqueue(Vehicles data){
+        Node* newNode = pool.acquire(data);
+        count++;
+        if (indexed) index.put(data.id, (uint64_t)(uintptr_t)newNode);
+
+        if (front == nullptr){
+            front = rear = newNode;
+        }
+        else{
+            newNode->prev = rear;
+            rear->next = newNode;
+            rear = newNode;
+        }
+        return true;
+    } 
+
+    // O(1) with the index: copies the vehicle out if it is queued here
+    bool Find(uint64_t id, Vehicles& out){
+        Node* node = findNode(id);
+        if (node == nullptr) return false;
+        out = node->data;
+        return true;
+    }
+
+    // Takes a vehicle out from anywhere in the lane without logging it
+    bool Remove(uint64_t id, Vehicles* removed = nullptr){
+        Node* node = findNode(id);
+        if (node == nullptr) return false;
+        if (removed != nullptr) *removed = node->data;
+        unlink(node);
+        return true;
+    }
+
+    // Moves a queued vehicle (an ambulance, say) to the front of the lane
+    bool Promote(uint64_t id){
+        Node* node = findNode(id);
+        if (node == nullptr) return false;
+        if (node == front) return true;
+        reorders++;
+        node->prev->next = node->next;
+        if (node->next != nullptr) node->next->prev = node->prev;
+        else rear = node->prev;
+        node->prev = nullptr;
+        node->next = front;
+        front->prev = node;
+        front = node;
+        return true;
+    }
+
+    // passed, when given, receives a copy of the vehicle that left
+    bool Dequeue(Vehicles* passed = nullptr) {
+        if (front == nullptr) {
+            if (!quietMode) cout << "The queue is empty" << endl;
+            return false;
+        }
+        Node* temp = front;
+        reorders++;
+        passedLog.log(temp->data.id); // Log the ID of the removed vehicle
+        if (passed != nullptr) *passed = temp->data;
+
+        if (!quietMode) cout << "Removing Vehicle ID: " << temp->data.Plate() << " from the lane." << endl; // Added message
+        if (indexed) index.erase(temp->data.id, (uint64_t)(uintptr_t)temp);
+        front = front->next;
+        pool.release(temp);
+        count--;
+        if (front == nullptr) { // Reset rear if queue is empty after dequeue
+            rear = nullptr;
+        } else {
+            front->prev = nullptr;
+        }
+        return true;
+    }
+
+    // The front vehicle, left in place; only for a lane that is not empty
+    const Vehicles& Peek() {
+        return front->data;
+    }
+
+    // Takes the front vehicle out without logging it (vehicle moves on to another lane)
+    bool Pop(Vehicles& out) {
+        if (front == nullptr) return false;
+        Node* temp = front;
+        reorders++;
+        out = std::move(temp->data);
+        if (indexed) index.erase(out.id, (uint64_t)(uintptr_t)temp);
+        front = front->next;
+        pool.release(temp);
+        count--;
+        if (front == nullptr) rear = nullptr;
+        else front->prev = nullptr;
+        return true;
+    }
+
+    int Size(){
+        return count;
+    }
+
+    long long PoolHighWaterMark(){
+        return pool.HighWaterMark();
+    }
+
+    long long HeapAllocations(){
+        return pool.Allocations();
+    }
+
+    long long PoolCapacity(){
+        return pool.Capacity();
+    }
+
+    // Copies the queued vehicles, front first, into out (room for Size() records)
+    void CopyTo(char* out){
+        for (Node* temp = front; temp != nullptr; temp = temp->next) {
+            memcpy(out, &temp->data, sizeof(Vehicles));
+            out += sizeof(Vehicles);
+        }
+    }
+
+    // Appends count vehicles stored back to back (as written by CopyTo) to the lane
+    bool Restore(const char* records, size_t count){
+        Vehicles vehicle;
+        for (size_t i = 0; i < count; i++) {
+            memcpy(&vehicle, records + i * sizeof(Vehicles), sizeof(Vehicles));
+            if (vehicle.type >= INVALID_VEHICLE) return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            memcpy(&vehicle, records + i * sizeof(Vehicles), sizeof(Vehicles));
+            Enqueue(vehicle);
+        }
+        return true;
+    }
+
+    // Calls visit on the vehicles at positions first .. first+count-1 (0 is the front),
+    // walking in from the front, the rear or the last page shown, whichever is nearest
+    template <class Visit>
+    void VisitRange(size_t first, size_t count, Visit visit){
+        size_t size = (size_t)this->count;
+        if (first >= size || count == 0) return;
+        count = min(count, size - first);
+        Node* node = front;
+        size_t at = 0;
+        if (size - 1 - first < first) {
+            node = rear;
+            at = size - 1;
+        }
+        if (cursor != nullptr && cursorReorders == reorders &&
+            (cursorAt > first ? cursorAt - first : first - cursorAt) < (at > first ? at - first : first - at)) {
+            node = cursor;
+            at = cursorAt;
+        }
+        for (; at < first; at++) node = node->next;
+        for (; at > first; at--) node = node->prev;
+        for (size_t i = 1; i < count; i++, node = node->next) visit(node->data);
+        visit(node->data);
+        cursor = node;
+        cursorAt = first + count - 1;
+        cursorReorders = reorders;
+    }
+
+    void Display(){
+        VisitRange(0, (size_t)count, [](const Vehicles& vehicle) { consoleRenderer.vehicle(vehicle); });
+        consoleRenderer.text("\n").write();
+    }
+
+    void Front(){
+        if (front == nullptr){
+            cout<<"The queue is empty"<<endl;
+            return;
+        }
+        front->data.displayInfo();
+    }
+
+    void Rear(){
+        if (rear == nullptr){
+            cout<<"The queue is empty"<<endl;
+            return;
+        }
+        rear->data.displayInfo();
+    }
+
+    void IsEmpty(){
+        if (front == nullptr){
+            cout<<"The queue is empty"<<endl;
+        }
+        else{
+            cout<<"The queue is not empty"<<endl;
+        }
+    }
+
+    void Clear() {
+    reorders++;
+    while (front != nullptr) {
+        Node* temp = front;
+        front = front->next;
+        pool.release(temp);
+    }
+    rear = nullptr;  // Reset rear to null after clearing
+    count = 0;
+    index.clear();
+}
+
+    ~ListQue(){
+        Clear();
+    }
+    
+};
+
+// Circular lane over a power-of-two array. front and rear are running counters
+// and a vehicle's slot is counter & mask, so both ends wrap without any modulo.
+// A growable lane doubles its array when full; a bounded one refuses the vehicle
+// instead so the caller can hold it upstream (backpressure).
+// With the ID index on, a vehicle can also leave from the middle: its slot becomes
+// a hole (type INVALID_VEHICLE) that the ends skip over, so the index can keep
+// pointing at running counters. The front and the last vehicle are never holes.
+class ArrayQue{
+    public:
+    vector<Vehicles> arr;
+    unsigned long long front, rear; // rear is one past the last vehicle
+    size_t capacity, mask;
+    size_t holes;
+    bool growable;
+    VehicleIndex index; // ID -> running counter, kept only when indexed
+    bool indexed;
+    long long allocations; // array (re)allocations, for the lane benchmark
+
+    static const int InputMode = 2;
+    static const char* Name() { return "Array"; }
+
+    static size_t roundUpToPowerOfTwo(size_t value){
+        size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    ArrayQue(size_t initialCapacity = 8, bool growable = true){
+        front = rear = 0;
+        holes = 0;
+        indexed = false;
+        allocations = 0;
+        Reset(initialCapacity, growable);
+    }
+
+    // Changes the capacity and mode; only allowed while the lane is empty
+    bool Reset(size_t newCapacity, bool growable){
+        if (!isEmpty()) return false;
+        capacity = roundUpToPowerOfTwo(newCapacity > 0 ? newCapacity : 1);
+        mask = capacity - 1;
+        if (arr.capacity() < capacity) allocations++;
+        arr.assign(capacity, Vehicles());
+        front = rear = 0;
+        holes = 0;
+        this->growable = growable;
+        return true;
+    }
+
+    bool isFull(){
+        return rear - front == capacity;
+    }
+
+    bool isEmpty(){
+        return front == rear;
+    }
+
+    long long HeapAllocations(){
+        return allocations;
+    }
+
+    void Grow(){
+        vector<Vehicles> bigger(capacity * 2);
+        allocations++;
+        size_t biggerMask = capacity * 2 - 1;
+        for (unsigned long long i = front; i != rear; i++) {
+            bigger[i & biggerMask] = std::move(arr[i & mask]);
+        }
+        arr.swap(bigger);
+        capacity *= 2;
+        mask = biggerMask;
+    }
+
+    // Closes up the holes, keeping the order; moved vehicles are re-indexed
+    void Compact(){
+        unsigned long long to = front;
+        for (unsigned long long i = front; i != rear; i++) {
+            if (arr[i & mask].type == INVALID_VEHICLE) continue;
+            if (to != i) {
+                arr[to & mask] = arr[i & mask];
+                if (indexed) index.put(arr[to & mask].id, to);
+            }
+            to++;
+        }
+        rear = to;
+        holes = 0;
+    }
+
+    void EnableIndex(){
+        if (indexed) return;
+        indexed = true;
+        for (unsigned long long i = front; i != rear; i++) {
+            if (arr[i & mask].type != INVALID_VEHICLE) index.put(arr[i & mask].id, i);
+        }
+    }
+
+    // Makes room in a full lane: holes are only worth compacting once they are a
+    // quarter of the array, otherwise a growable lane doubles (which keeps counters)
+    bool makeRoom(){
+        if (holes > 0 && (holes * 4 >= capacity || !growable)) Compact();
+        else if (growable) Grow();
+        else return false;
+        return true;
+    }
+
+    bool Enqueue(Vehicles value){
+        if (isFull()){
+            if (!growable && holes == 0) {
+                if (!quietMode) cout<<"The Lane is full, you can't add more vehicles!"<<endl;
+                return false;
+            }
+            makeRoom();
+        }
+        if (indexed) index.put(value.id, rear);
+        arr[rear & mask] = std::move(value);
+        rear++;
+        return true;
+    }
+
+    // Drops holes left at either end by Remove/Promote
+    void trimHoles(){
+        while (front != rear && arr[front & mask].type == INVALID_VEHICLE) {
+            front++;
+            holes--;
+        }
+        while (front != rear && arr[(rear - 1) & mask].type == INVALID_VEHICLE) {
+            rear--;
+            holes--;
+        }
+    }
+
+    // Running counter of a queued vehicle, through the index
+    bool locate(uint64_t id, unsigned long long& at){
+        uint64_t stored;
+        if (!indexed || !index.get(id, stored)) return false;
+        at = stored;
+        return true;
+    }
+
+    // passed, when given, receives a copy of the vehicle that left
+    bool Dequeue(Vehicles* passed = nullptr) {
+    if (isEmpty()) {
+        if (!quietMode) cout << "The Lane is already Empty!" << endl;
+        return false;
+    }
+    Vehicles& vehicle = arr[front & mask];
+    passedLog.log(vehicle.id);
+    if (passed != nullptr) *passed = vehicle;
+
+    if (!quietMode) cout << "Removing Vehicle ID: " << vehicle.Plate() << " from the lane." << endl; // Added message
+    if (indexed) index.erase(vehicle.id, front);
+    front++;
+    if (holes > 0) trimHoles();
+    return true;
+}
+
+    // The front vehicle, left in place (never a hole); only for a lane that is not empty
+    const Vehicles& Peek(){
+        return arr[front & mask];
+    }
+
+    // Takes the front vehicle out without logging it (vehicle moves on to another lane)
+    bool Pop(Vehicles& out){
+        if (isEmpty()) return false;
+        out = std::move(arr[front & mask]);
+        if (indexed) index.erase(out.id, front);
+        front++;
+        if (holes > 0) trimHoles();
+        return true;
+    }
+
+    // O(1) with the index: copies the vehicle out if it is queued here
+    bool Find(uint64_t id, Vehicles& out){
+        unsigned long long at;
+        if (!locate(id, at)) return false;
+        out = arr[at & mask];
+        return true;
+    }
+
+    // Takes a vehicle out from anywhere in the lane without logging it
+    bool Remove(uint64_t id, Vehicles* removed = nullptr){
+        unsigned long long at;
+        if (!locate(id, at)) return false;
+        Vehicles& vehicle = arr[at & mask];
+        if (removed != nullptr) *removed = vehicle;
+        index.erase(id, at);
+        vehicle.type = INVALID_VEHICLE;
+        holes++;
+        trimHoles();
+        return true;
+    }
+
+    // Moves a queued vehicle to the front: its old slot becomes a hole and it
+    // takes the slot just before front
+    bool Promote(uint64_t id){
+        unsigned long long at;
+        if (!locate(id, at)) return false;
+        if (at == front) return true;
+        Vehicles vehicle = arr[at & mask];
+        arr[at & mask].type = INVALID_VEHICLE;
+        holes++;
+        trimHoles();
+        if (isFull()) makeRoom(); // never fails: the hole just made can be compacted
+        front--;
+        arr[front & mask] = vehicle;
+        index.put(id, front);
+        return true;
+    }
+
+    int Size(){
+        return (int)(rear - front - holes);
+    }
+
+    size_t Capacity(){
+        return capacity;
+    }
+
+    // Copies the queued vehicles, front first, into out (room for Size() records)
+    void CopyTo(char* out){
+        if (holes > 0) {
+            for (unsigned long long i = front; i != rear; i++) {
+                if (arr[i & mask].type == INVALID_VEHICLE) continue;
+                memcpy(out, &arr[i & mask], sizeof(Vehicles));
+                out += sizeof(Vehicles);
+            }
+            return;
+        }
+        size_t count = Size();
+        size_t first = min(count, capacity - (size_t)(front & mask)); // up to the end of the array
+        memcpy(out, &arr[front & mask], first * sizeof(Vehicles));
+        memcpy(out + first * sizeof(Vehicles), &arr[0], (count - first) * sizeof(Vehicles));
+    }
+
+    // Fills an empty lane with count vehicles in one copy; a bounded lane refuses more than it holds.
+    // A record of type INVALID_VEHICLE is refused like in Enqueue's callers, since here it would mark a hole.
+    bool Restore(const char* records, size_t count){
+        if (!isEmpty()) return false;
+        Vehicles vehicle;
+        for (size_t i = 0; i < count; i++) {
+            memcpy(&vehicle, records + i * sizeof(Vehicles), sizeof(Vehicles));
+            if (vehicle.type >= INVALID_VEHICLE) return false;
+        }
+        if (count > capacity) {
+            if (!growable) return false;
+            capacity = roundUpToPowerOfTwo(count);
+            mask = capacity - 1;
+            arr.assign(capacity, Vehicles());
+        }
+        memcpy(arr.data(), records, count * sizeof(Vehicles));
+        front = 0;
+        rear = count;
+        if (indexed) {
+            for (size_t i = 0; i < count; i++) index.put(arr[i].id, i);
+        }
+        return true;
+    }
+
+    // Calls visit on the vehicles at positions first .. first+count-1 (0 is the front).
+    // Without holes that is a direct jump; with holes the walk starts from the nearer end.
+    template <class Visit>
+    void VisitRange(size_t first, size_t count, Visit visit){
+        size_t size = (size_t)Size();
+        if (first >= size) return;
+        count = min(count, size - first);
+        unsigned long long at;
+        if (holes == 0) {
+            at = front + first;
+        } else if (first <= size - 1 - first) {
+            at = front;
+            for (size_t live = 0; ; at++) {
+                if (arr[at & mask].type == INVALID_VEHICLE) continue;
+                if (live++ == first) break;
+            }
+        } else {
+            at = rear - 1;
+            for (size_t live = size - 1; ; at--) {
+                if (arr[at & mask].type == INVALID_VEHICLE) continue;
+                if (live-- == first) break;
+            }
+        }
+        for (; count > 0; at++) {
+            if (arr[at & mask].type == INVALID_VEHICLE) continue;
+            visit(arr[at & mask]);
+            count--;
+        }
+    }
+
+    void Display(){
+        VisitRange(0, (size_t)Size(), [](const Vehicles& vehicle) { consoleRenderer.vehicle(vehicle); });
+        consoleRenderer.write();
+    }
+};
+
+enum SignalPhase { RED, GREEN, YELLOW };
+
+// A signal cycles Red -> Green -> Yellow. Instead of stepping through every
+// phase change, it only remembers how far into the cycle it is, so advancing
+// by any amount of time is one modulo and at most two comparisons.
+class TrafficSignal{
+    public:
+    SignalPhase phase;
+    int duration;      // seconds left in the current phase
+    int redTime, greenTime, yellowTime;
+    int cycleLength;
+    int cycleOffset;   // seconds since the current cycle turned red
+
+    TrafficSignal(int redTime = 10, int greenTime = 15, int yellowTime = 5){
+        setTimings(redTime, greenTime, yellowTime);
+    }
+
+    // Restarts the signal at the beginning of its red phase. Every phase lasts at least a second.
+    void setTimings(int redTime, int greenTime, int yellowTime){
+        this->redTime = redTime > 0 ? redTime : 1;
+        this->greenTime = greenTime > 0 ? greenTime : 1;
+        this->yellowTime = yellowTime > 0 ? yellowTime : 1;
+        cycleLength = this->redTime + this->greenTime + this->yellowTime;
+        cycleOffset = 0;
+        updatePhase();
+    }
+
+    void updatePhase(){
+        if (cycleOffset < redTime) {
+            phase = RED;
+            duration = redTime - cycleOffset;
+        } else if (cycleOffset < redTime + greenTime) {
+            phase = GREEN;
+            duration = redTime + greenTime - cycleOffset;
+        } else {
+            phase = YELLOW;
+            duration = cycleLength - cycleOffset;
+        }
+    }
+
+    void changeSignal(long long elapsedTime) {
+        if (elapsedTime <= 0) return;
+        cycleOffset = (int)((cycleOffset + elapsedTime % cycleLength) % cycleLength);
+        updatePhase();
+    }
+
+    // Seconds until the current or next green phase ends (at least 1)
+    long long secondsToGreenEnd() {
+        int yellowStart = redTime + greenTime;
+        return cycleOffset < yellowStart ? yellowStart - cycleOffset : cycleLength - cycleOffset + yellowStart;
+    }
+
+    // How many green phases end within the next elapsedTime seconds
+    long long greenEndsWithin(long long elapsedTime) {
+        if (elapsedTime <= 0) return 0;
+        int yellowStart = redTime + greenTime;
+        if (elapsedTime < cycleLength) {
+            // at most one boundary ahead: this cycle's, or the next one's after wrapping
+            long long to = cycleOffset + elapsedTime;
+            return (cycleOffset < yellowStart && to >= yellowStart) || to >= cycleLength + yellowStart;
+        }
+        long long from = cycleOffset - yellowStart + cycleLength; // both kept positive for the division
+        return (from + elapsedTime) / cycleLength - from / cycleLength;
+    }
+
+    const char* stateName() {
+        if (phase == RED) return "Red";
+        if (phase == GREEN) return "Green";
+        return "Yellow";
+    }
+
+    void displaySignal() {
+        cout << "Signal: " << stateName() << " | Remaining Duration: " << duration << " seconds" << endl;
+    }
+
+    bool canPass(){
+        return phase == GREEN;
+    }
+
+    void save(SnapshotWriter& out){
+        out.put((int32_t)redTime);
+        out.put((int32_t)greenTime);
+        out.put((int32_t)yellowTime);
+        out.put((int32_t)cycleOffset);
+    }
+
+    bool load(SnapshotReader& in){
+        int red = in.get<int32_t>();
+        int green = in.get<int32_t>();
+        int yellow = in.get<int32_t>();
+        int offset = in.get<int32_t>();
+        if (!in.ok()) return false;
+        setTimings(red, green, yellow);
+        cycleOffset = offset >= 0 ? offset % cycleLength : 0;
+        updatePhase();
+        return true;
+    }
+};
+
+// Many signals stored column by column: cycle offset, phase, remaining time and
+// the phase boundaries each live in their own array, and a bitmask holds one
+// "is green" bit per signal. advance() moves every signal forward with the same
+// branch-free arithmetic, four signals at a time when SSE2 is available.
+// Arrays are padded to a multiple of 64 with signals that stay red forever.
+class SignalBank {
+    vector<int32_t> offset;
+    vector<int32_t> redEnd;      // offset where green starts
+    vector<int32_t> greenEnd;    // offset where yellow starts
+    vector<int32_t> cycle;
+    vector<int32_t> remaining;
+    vector<uint8_t> phase;
+    vector<uint64_t> greenMask;
+    int count;
+    int shortestCycle;
+
+    enum { paddingCycle = 1 << 30 };
+
+    // Phase, remaining time and mask bits for signals [begin, end), begin a multiple of 64
+    void refresh(int begin, int end) {
+        for (int block = begin; block < end; block += 64) {
+            uint64_t bits = 0;
+#if defined(__SSE2__)
+            for (int j = 0; j < 64; j += 4) {
+                int i = block + j;
+                __m128i off = _mm_loadu_si128((const __m128i*)&offset[i]);
+                __m128i red = _mm_loadu_si128((const __m128i*)&redEnd[i]);
+                __m128i green = _mm_loadu_si128((const __m128i*)&greenEnd[i]);
+                __m128i full = _mm_loadu_si128((const __m128i*)&cycle[i]);
+                // all ones where the signal is past red / past green
+                __m128i pastRed = _mm_cmpgt_epi32(off, _mm_sub_epi32(red, _mm_set1_epi32(1)));
+                __m128i pastGreen = _mm_cmpgt_epi32(off, _mm_sub_epi32(green, _mm_set1_epi32(1)));
+                __m128i end = _mm_xor_si128(red, _mm_and_si128(_mm_xor_si128(red, green), pastRed));
+                end = _mm_xor_si128(end, _mm_and_si128(_mm_xor_si128(end, full), pastGreen));
+                _mm_storeu_si128((__m128i*)&remaining[i], _mm_sub_epi32(end, off));
+                __m128i phases = _mm_sub_epi32(_mm_setzero_si128(), _mm_add_epi32(pastRed, pastGreen));
+                int32_t lanes[4];
+                _mm_storeu_si128((__m128i*)lanes, phases);
+                for (int k = 0; k < 4; k++) phase[i + k] = (uint8_t)lanes[k];
+                __m128i isGreen = _mm_andnot_si128(pastGreen, pastRed);
+                bits |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(isGreen)) << j;
+            }
+#else
+            for (int j = 0; j < 64; j++) {
+                int i = block + j;
+                int32_t off = offset[i];
+                int32_t pastRed = off >= redEnd[i];
+                int32_t pastGreen = off >= greenEnd[i];
+                int32_t end = pastGreen ? cycle[i] : (pastRed ? greenEnd[i] : redEnd[i]);
+                remaining[i] = end - off;
+                phase[i] = (uint8_t)(pastRed + pastGreen);
+                bits |= (uint64_t)(pastRed & !pastGreen) << j;
+            }
+#endif
+            greenMask[block >> 6] = bits;
+        }
+    }
+
+public:
+    SignalBank() {
+        count = 0;
+        shortestCycle = paddingCycle;
+    }
+
+    // Returns the index of the new signal; offset is how far into its cycle it starts
+    int add(int redTime, int greenTime, int yellowTime, long long startOffset = 0) {
+        if (count % 64 == 0) {
+            int padded = count + 64;
+            offset.resize(padded, 0);
+            redEnd.resize(padded, paddingCycle);
+            greenEnd.resize(padded, paddingCycle);
+            cycle.resize(padded, paddingCycle);
+            remaining.resize(padded, paddingCycle);
+            phase.resize(padded, RED);
+            greenMask.resize(padded / 64, 0);
+        }
+        TrafficSignal timings(redTime, greenTime, yellowTime); // same validation as a single signal
+        int i = count++;
+        redEnd[i] = timings.redTime;
+        greenEnd[i] = timings.redTime + timings.greenTime;
+        cycle[i] = timings.cycleLength;
+        offset[i] = (int32_t)(startOffset > 0 ? startOffset % timings.cycleLength : 0);
+        if (cycle[i] < shortestCycle) shortestCycle = cycle[i];
+        refresh(i & ~63, (i & ~63) + 64);
+        return i;
+    }
+
+    int Size() {
+        return count;
+    }
+
+    int Blocks() {
+        return (int)greenMask.size();
+    }
+
+    // Moves every signal in 64-signal blocks [firstBlock, lastBlock) forward by elapsedTime.
+    // Different threads may advance disjoint block ranges at the same time.
+    void advanceBlocks(long long elapsedTime, int firstBlock, int lastBlock) {
+        if (elapsedTime <= 0) return;
+        int begin = firstBlock * 64;
+        int end = lastBlock * 64;
+        int32_t* __restrict off = offset.data();
+        const int32_t* __restrict full = cycle.data();
+        if (elapsedTime < shortestCycle) {
+            // one conditional subtraction keeps every offset inside its cycle
+            int32_t step = (int32_t)elapsedTime;
+            for (int i = begin; i < end; i++) {
+                int32_t next = off[i] + step;
+                off[i] = next - (next >= full[i] ? full[i] : 0);
+            }
+        } else {
+            for (int i = begin; i < end; i++) {
+                off[i] = (int32_t)((off[i] + elapsedTime % full[i]) % full[i]);
+            }
+        }
+        refresh(begin, end);
+    }
+
+    void advance(long long elapsedTime) {
+        advanceBlocks(elapsedTime, 0, Blocks());
+    }
+
+    bool isGreen(int i) {
+        return (greenMask[i >> 6] >> (i & 63)) & 1;
+    }
+
+    const vector<uint64_t>& GreenMask() {
+        return greenMask;
+    }
+
+    SignalPhase Phase(int i) {
+        return (SignalPhase)phase[i];
+    }
+
+    int Remaining(int i) {
+        return remaining[i];
+    }
+
+    // Only the offsets and phase boundaries are stored; phases, remaining times
+    // and the green mask are recomputed on load
+    void save(SnapshotWriter& out) {
+        out.put((int32_t)count);
+        const vector<int32_t>* columns[4] = {&offset, &redEnd, &greenEnd, &cycle};
+        for (const vector<int32_t>* column : columns) {
+            char* stored = out.putArray<int32_t>(column->size());
+            memcpy(stored, column->data(), column->size() * sizeof(int32_t));
+        }
+    }
+
+    bool load(SnapshotReader& in) {
+        int stored = in.get<int32_t>();
+        int padded = (stored + 63) / 64 * 64;
+        vector<int32_t>* columns[4] = {&offset, &redEnd, &greenEnd, &cycle};
+        for (vector<int32_t>* column : columns) {
+            size_t size;
+            const char* values = in.getArray<int32_t>(size);
+            if (!in.ok() || size != (size_t)padded) return false;
+            column->resize(size);
+            memcpy(column->data(), values, size * sizeof(int32_t));
+        }
+        count = stored;
+        remaining.assign(padded, paddingCycle);
+        phase.assign(padded, RED);
+        greenMask.assign(padded / 64, 0);
+        shortestCycle = paddingCycle;
+        for (int i = 0; i < count; i++) {
+            if (cycle[i] <= 0 || offset[i] < 0 || offset[i] >= cycle[i]) return false;
+            if (cycle[i] < shortestCycle) shortestCycle = cycle[i];
+        }
+        refresh(0, padded);
+        return true;
+    }
+};
+
+// Log-linear histogram in the style of HdrHistogram: values below 16 have a bucket
+// each, and every larger power of two is split into 16 buckets, so a bucket is at
+// most 6.25% wide. Each histogram has a single writer, so record() is a plain
+// increment; other threads read the copy the writer last made with publish().
+class WaitHistogram {
+public:
+    enum { subBits = 4, subCount = 1 << subBits, maxBits = 40, bucketCount = (maxBits - subBits + 1) * subCount };
+
+private:
+    uint64_t counts[bucketCount];
+    atomic<uint64_t> published[bucketCount];
+
+public:
+    WaitHistogram() {
+        for (uint64_t& count : counts) count = 0;
+        for (atomic<uint64_t>& count : published) count.store(0, memory_order_relaxed);
+    }
+
+    // Branch-free: values below 32 map to themselves, and past that each doubling
+    // shifts one more bit off so (value >> shift) stays within [16, 32)
+    static int bucketOf(uint64_t value) {
+        value = min<uint64_t>(value, (1ULL << maxBits) - 1);
+        int shift = 63 - __builtin_clzll(value | (2 * subCount - 1)) - subBits;
+        return (shift << subBits) + (int)(value >> shift);
+    }
+
+    // Smallest value that lands in bucket
+    static uint64_t lowestOf(int bucket) {
+        if (bucket < subCount) return (uint64_t)bucket;
+        int shift = bucket / subCount - 1;
+        return (uint64_t)(subCount + bucket % subCount) << shift;
+    }
+
+    void record(uint64_t value) {
+        counts[bucketOf(value)]++;
+    }
+
+    // Writer thread only
+    void publish() {
+        for (int i = 0; i < bucketCount; i++) published[i].store(counts[i], memory_order_relaxed);
+    }
+
+    // Adds the published counts, so any thread may call it
+    void addTo(vector<uint64_t>& totals) {
+        totals.resize(bucketCount, 0);
+        for (int i = 0; i < bucketCount; i++) totals[i] += published[i].load(memory_order_relaxed);
+    }
+
+    // Value at quantile q (0..1) of histogram counts, reported as the bucket's lowest value
+    static uint64_t percentile(const vector<uint64_t>& totals, double q) {
+        uint64_t total = 0;
+        for (uint64_t count : totals) total += count;
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(q * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < totals.size(); i++) {
+            seen += totals[i];
+            if (seen >= rank) return lowestOf((int)i);
+        }
+        return lowestOf((int)totals.size() - 1);
+    }
+};
+
+// Counters for one lane class. Several roads may share one LaneMetrics as long as
+// only one thread updates it (a grid gives each worker thread its own). The
+// counters are plain and owned by that thread; readers see the copies in shared,
+// which the owner refreshes in publish(). Waits are recorded here as each vehicle
+// leaves; the other counts are tallied in each road and merged in by addTally()
+// just before. The alignment keeps two LaneMetrics off the same cache line.
+struct alignas(64) LaneMetrics {
+    long long arrived = 0;
+    long long departed = 0;
+    long long queued = 0;           // vehicles in the lanes now, over every road merged in
+    long long waitSum = 0;          // simulated seconds over every departure, for the mean
+    long long maxDepth = 0;         // deepest single lane seen
+    long long greens = 0;           // completed green phases
+    long long greenPassed = 0;      // vehicles that left during completed green phases
+    long long maxPerGreen = 0;
+    WaitHistogram waits;            // seconds from arrival to leaving the lane
+    WaitHistogram perGreen;         // vehicles that left during one green phase
+
+    struct Shared {
+        atomic<long long> arrived{0}, departed{0}, queued{0}, waitSum{0}, maxDepth{0}, greens{0}, greenPassed{0}, maxPerGreen{0};
+    } shared;
+
+    void addTally(long long arrivals, long long departures, long long depthChange, long long deepest) {
+        arrived += arrivals;
+        departed += departures;
+        queued += depthChange;
+        if (deepest > maxDepth) maxDepth = deepest;
+    }
+
+    void onWait(long long waited) {
+        waitSum += waited;
+        waits.record((uint64_t)waited);
+    }
+
+    void onGreenEnd(long long passed) {
+        greens++;
+        greenPassed += passed;
+        perGreen.record((uint64_t)passed);
+        if (passed > maxPerGreen) maxPerGreen = passed;
+    }
+
+    // Owner thread only
+    void publish() {
+        shared.arrived.store(arrived, memory_order_relaxed);
+        shared.departed.store(departed, memory_order_relaxed);
+        shared.queued.store(queued, memory_order_relaxed);
+        shared.waitSum.store(waitSum, memory_order_relaxed);
+        shared.maxDepth.store(maxDepth, memory_order_relaxed);
+        shared.greens.store(greens, memory_order_relaxed);
+        shared.greenPassed.store(greenPassed, memory_order_relaxed);
+        shared.maxPerGreen.store(maxPerGreen, memory_order_relaxed);
+        waits.publish();
+        perGreen.publish();
+    }
+};
+
+// The owner publishes when a reader has asked (checked once per tick or green
+// phase, so the hot path never touches shared memory) and once more at the end
+// of its run.
+struct RoadMetrics {
+    LaneMetrics lanes[3];  // indexed by VehicleClass
+    atomic<bool> wanted{false};
+
+    void publish() {
+        for (LaneMetrics& lane : lanes) lane.publish();
+        wanted.store(false, memory_order_release);
+    }
+};
+
+// Sums of any number of LaneMetrics, as last published
+struct LaneMetricsTotals {
+    long long arrived = 0, departed = 0, queued = 0, waitSum = 0, maxDepth = 0, greens = 0, greenPassed = 0, maxPerGreen = 0;
+    vector<uint64_t> waits, perGreen;
+
+    void add(LaneMetrics& lane) {
+        arrived += lane.shared.arrived.load(memory_order_relaxed);
+        waitSum += lane.shared.waitSum.load(memory_order_relaxed);
+        maxDepth = max(maxDepth, lane.shared.maxDepth.load(memory_order_relaxed));
+        greens += lane.shared.greens.load(memory_order_relaxed);
+        greenPassed += lane.shared.greenPassed.load(memory_order_relaxed);
+        maxPerGreen = max(maxPerGreen, lane.shared.maxPerGreen.load(memory_order_relaxed));
+        departed += lane.shared.departed.load(memory_order_relaxed);
+        queued += lane.shared.queued.load(memory_order_relaxed);
+        lane.waits.addTo(waits);
+        lane.perGreen.addTo(perGreen);
+    }
+};
+
+// Writes the totals of a set of RoadMetrics every intervalMs from a background
+// thread (JSON to a file, rewritten each time) and prints a text table on demand.
+// Throughput is vehicles leaving per second of wall time since the previous report.
+// The background reports ask the owners to publish first; finish() and printTable()
+// run after the simulation, which has published its final counts by then.
+class MetricsReporter {
+    vector<RoadMetrics*> sources;
+    string jsonFile;
+    int intervalMs;
+    mutex lock;
+    condition_variable wakeUp;
+    thread reporter;
+    bool stopping;
+    chrono::steady_clock::time_point startTime, lastTime;
+    long long lastDeparted[3];
+
+    void reportLoop() {
+        unique_lock<mutex> guard(lock);
+        while (!wakeUp.wait_for(guard, chrono::milliseconds(intervalMs), [this] { return stopping; })) {
+            guard.unlock();
+            refreshSources();
+            writeJson();
+            guard.lock();
+        }
+    }
+
+public:
+    long long reports; // JSON reports written
+    long long failed;  // and ones that could not be
+
+    MetricsReporter(const vector<RoadMetrics*>& sources, const string& jsonFile = "", int intervalMs = 1000) {
+        this->sources = sources;
+        this->jsonFile = jsonFile;
+        this->intervalMs = intervalMs > 0 ? intervalMs : 1000;
+        stopping = false;
+        reports = 0;
+        failed = 0;
+        startTime = lastTime = chrono::steady_clock::now();
+        for (long long& count : lastDeparted) count = 0;
+        if (!jsonFile.empty()) reporter = thread(&MetricsReporter::reportLoop, this);
+    }
+
+    // Asks every owner for fresh copies and gives them up to 50 ms to publish; an
+    // owner that misses it (e.g. one that has finished) is reported as last published
+    void refreshSources() {
+        for (RoadMetrics* source : sources) source->wanted.store(true, memory_order_relaxed);
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(min(intervalMs, 50));
+        for (RoadMetrics* source : sources) {
+            while (source->wanted.load(memory_order_acquire) && chrono::steady_clock::now() < deadline) {
+                this_thread::sleep_for(chrono::microseconds(200));
+            }
+        }
+    }
+
+    void collect(LaneMetricsTotals totals[3]) {
+        for (RoadMetrics* source : sources) {
+            for (int lane = 0; lane < 3; lane++) totals[lane].add(source->lanes[lane]);
+        }
+    }
+
+    void writeJson() {
+        LaneMetricsTotals totals[3];
+        collect(totals);
+        auto now = chrono::steady_clock::now();
+        double interval = chrono::duration<double>(now - lastTime).count();
+        ostringstream json;
+        json << "{\"elapsed_ms\": " << chrono::duration<double, milli>(now - startTime).count() << ", \"lanes\": [";
+        for (int lane = 0; lane < 3; lane++) {
+            LaneMetricsTotals& t = totals[lane];
+            double throughput = interval > 0 ? (t.departed - lastDeparted[lane]) / interval : 0;
+            lastDeparted[lane] = t.departed;
+            json << (lane > 0 ? ", " : "") << "{\"lane\": \"" << laneTypes[lane] << "\", \"arrived\": " << t.arrived
+                 << ", \"departed\": " << t.departed << ", \"queued\": " << t.queued
+                 << ", \"max_depth\": " << t.maxDepth << ", \"throughput_per_s\": " << throughput
+                 << ", \"wait_s\": {\"mean\": " << (t.departed > 0 ? (double)t.waitSum / t.departed : 0)
+                 << ", \"p50\": " << WaitHistogram::percentile(t.waits, 0.50)
+                 << ", \"p90\": " << WaitHistogram::percentile(t.waits, 0.90)
+                 << ", \"p99\": " << WaitHistogram::percentile(t.waits, 0.99)
+                 << ", \"max\": " << WaitHistogram::percentile(t.waits, 1.0) << "}"
+                 << ", \"greens\": " << t.greens << ", \"per_green\": {\"mean\": "
+                 << (t.greens > 0 ? (double)t.greenPassed / t.greens : 0)
+                 << ", \"p50\": " << WaitHistogram::percentile(t.perGreen, 0.50)
+                 << ", \"max\": " << t.maxPerGreen << "}}";
+        }
+        json << "]}\n";
+        lastTime = now;
+        if (writeFile(json.str())) {
+            reports++;
+        } else {
+            // the first failure is reported as it happens, the count at the end
+            if (failed++ == 0) cout << "Error: Unable to write to " << jsonFile << endl;
+        }
+    }
+
+    // Writes next to jsonFile and renames it over, so a reader never sees half a report;
+    // on failure the temporary is removed and the previous report is left in place
+    bool writeFile(const string& text) {
+        string temporary = jsonFile + ".tmp";
+        bool written;
+        {
+            ofstream file(temporary, ios::trunc);
+            file << text;
+            file.close();
+            written = !file.fail();
+        }
+#if defined(_WIN32)
+        if (written) remove(jsonFile.c_str()); // rename() does not replace an existing file on Windows
+#endif
+        if (written && rename(temporary.c_str(), jsonFile.c_str()) == 0) return true;
+        remove(temporary.c_str());
+        return false;
+    }
+
+    void printSummary() {
+        cout << "Metrics written to " << jsonFile << " (" << reports << " reports)" << endl;
+        if (failed > 0) cout << "WARNING: " << failed << " metrics writes to " << jsonFile << " failed" << endl;
+    }
+
+    void printTable() {
+        LaneMetricsTotals totals[3];
+        collect(totals);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        cout << "\nLane    Departed  MaxDepth  WaitP50   WaitP90   WaitP99   WaitMax   Greens    PerGreen  MaxGreen  Out/s" << endl;
+        for (int lane = 0; lane < 3; lane++) {
+            LaneMetricsTotals& t = totals[lane];
+            cout << laneTypes[lane];
+            for (size_t pad = laneTypes[lane].size(); pad < 8; pad++) cout << ' ';
+            long long values[10] = {t.departed, t.maxDepth,
+                                    (long long)WaitHistogram::percentile(t.waits, 0.50),
+                                    (long long)WaitHistogram::percentile(t.waits, 0.90),
+                                    (long long)WaitHistogram::percentile(t.waits, 0.99),
+                                    (long long)WaitHistogram::percentile(t.waits, 1.0),
+                                    t.greens, t.greens > 0 ? t.greenPassed / t.greens : 0, t.maxPerGreen,
+                                    seconds > 0 ? (long long)(t.departed / seconds) : 0};
+            for (long long value : values) {
+                string text = to_string(value);
+                cout << text;
+                for (size_t pad = text.size(); pad < 10; pad++) cout << ' ';
+            }
+            cout << endl;
+        }
+        cout << "(waits in simulated seconds, percentiles within 6.25%)" << endl;
+    }
+
+    // Stops the background thread after one last JSON report
+    void finish() {
+        {
+            lock_guard<mutex> guard(lock);
+            if (stopping) return;
+            stopping = true;
+        }
+        wakeUp.notify_one();
+        if (reporter.joinable()) {
+            reporter.join();
+            writeJson();
+        }
+    }
+
+    ~MetricsReporter() {
+        finish();
+    }
+};
+
+// Lane policy hooks that only some lane types support; Road<Lane> picks the
+// right overload at compile time.
+bool configureLaneCapacity(ListQue&, size_t, bool) {
+    return false;
+}
+
+bool configureLaneCapacity(ArrayQue& lane, size_t capacity, bool growable) {
+    return lane.Reset(capacity, growable);
+}
+
+string laneStats(ListQue& lane) {
+    return "pool high-water " + to_string(lane.PoolHighWaterMark()) + " nodes";
+}
+
+string laneStats(ArrayQue& lane) {
+    return "capacity " + to_string(lane.Capacity()) + (lane.growable ? " (growable)" : " (bounded)");
+}
+
+// The parts of an intersection that do not depend on how lanes are stored:
+// signals, the clock and the runtime interface used by the menu and by tools
+// that choose the lane type at run time. Hot loops use Road<Lane> directly.
+class RoadBase {
+public:
+    long long clock; // simulated seconds, stamped on arriving vehicles
+
+    // Optional instrumentation, see attachMetrics(). The counts every departure updates
+    // sit beside the clock, so recording one touches no other line of the road; the
+    // rest of each lane's tally is only read when merging.
+    RoadMetrics* metrics;
+    long long departed[3]; // per lane, since the road was built
+    long long deepest[3];  // per lane, deepest since the last merge
+
+    TrafficSignal TruckSignal;
+    TrafficSignal CarSignal;
+    TrafficSignal BikeSignal;
+
+    int inputMode; // 1 for Linked List, 2 for Array
+
+    // Signals indexed by VehicleClass
+    TrafficSignal* signals[3];
+
+    // Each lane also tallies its removals, and mergeMetrics() adds what is new to
+    // metrics, along with the change in the lane's depth (its Size(), so restored
+    // vehicles count too). Arrivals are worked out from those rather than counted one
+    // by one, and the depth is checked just before a vehicle leaves, which is when it peaks.
+    struct LaneTally {
+        long long removed = 0;
+        long long mergedDeparted = 0, mergedRemoved = 0, mergedDepth = 0;
+        long long departedAtGreenEnd = 0;
+    };
+    LaneTally tallies[3];
+    long long nextGreenEnd; // clock when the next green phase ends, see updateAllSignals()
+
+    // Optional columnar log of passed vehicles, see attachPassLog()
+    PassLogWriter* passLog;
+    uint32_t intersection; // recorded with each passed vehicle
+
+    RoadBase(int inputMode) {
+        this->inputMode = inputMode;
+        clock = 0;
+        metrics = nullptr;
+        passLog = nullptr;
+        intersection = 0;
+        nextGreenEnd = 0;
+        for (int lane = 0; lane < 3; lane++) departed[lane] = deepest[lane] = 0;
+        signals[TRUCK] = &TruckSignal;
+        signals[CAR] = &CarSignal;
+        signals[BIKE] = &BikeSignal;
+    }
+
+    RoadBase(const RoadBase&) = delete;
+    RoadBase& operator=(const RoadBase&) = delete;
+
+    virtual ~RoadBase() {}
+
+    virtual const char* LaneName() = 0;
+    virtual bool AddVehiclesToLane(Vehicles vehicle) = 0;
+    // Returns true only when a vehicle actually left the lane; passed receives it
+    virtual bool DequeueVehiclesFromLanes(VehicleClass lane, Vehicles* passed = nullptr) = 0;
+    // Takes the front vehicle regardless of the signal (for callers that keep their own signals)
+    virtual bool TakeVehicle(VehicleClass lane, Vehicles& out) = 0;
+    virtual int LaneSize(VehicleClass lane) = 0;
+    // Renders the lanes through consoleRenderer in one write; only the vehicles shown are visited
+    virtual void DisplayAllLanes(const DisplayOptions& options = DisplayOptions()) = 0;
+    // Array lanes grow on demand by default; a bounded lane rejects vehicles once full
+    virtual bool setLaneCapacity(size_t capacity, bool growable) = 0;
+    virtual string LaneStats(VehicleClass lane) = 0;
+    // Clock and lane contents only; the signals are saved separately so a grid can keep them in a SignalBank
+    virtual void saveLanes(SnapshotWriter& out) = 0;
+    virtual bool loadLanes(SnapshotReader& in) = 0;
+    // ID lookups below need the per-lane index, which costs a hash update per vehicle
+    virtual void enableVehicleIndex() = 0;
+    // Lane of a queued vehicle, or INVALID_VEHICLE; record receives a copy when given
+    virtual VehicleClass LocateVehicle(uint64_t id, Vehicles* record = nullptr) = 0;
+    // Takes a vehicle out of its lane wherever it stands (it never passes the signal)
+    virtual bool RemoveVehicle(uint64_t id) = 0;
+    // Moves a vehicle to the front of its lane, e.g. an ambulance stuck in the queue
+    virtual bool PromoteVehicle(uint64_t id) = 0;
+
+    // Writes the whole intersection (plates, signals, clock and lanes) as a standalone snapshot
+    void saveState(vector<char>& buffer) {
+        SnapshotWriter out(buffer, ROAD_SNAPSHOT);
+        out.put((int32_t)inputMode);
+        plateRegistry.save(out);
+        for (TrafficSignal* signal : signals) signal->save(out);
+        saveLanes(out);
+        SnapshotWriter::seal(buffer);
+    }
+
+    // in must already be open(); the lanes must be empty
+    bool loadState(SnapshotReader& in) {
+        if (in.kind != ROAD_SNAPSHOT) return false;
+        in.get<int32_t>(); // lane type it was saved from; any lane type can load it
+        if (!plateRegistry.load(in)) return false;
+        for (TrafficSignal* signal : signals) {
+            if (!signal->load(in)) return false;
+        }
+        nextGreenEnd = 0;
+        return loadLanes(in) && in.AtEnd();
+    }
+
+    // Starts recording into metrics (nullptr stops); several roads may share one RoadMetrics.
+    // The old metrics keeps what was merged so far, except for this road's queued vehicles,
+    // which move to the new one. Both must belong to the calling thread.
+    void attachMetrics(RoadMetrics* metrics) {
+        mergeMetrics();
+        for (int lane = 0; lane < 3; lane++) {
+            LaneTally& tally = tallies[lane];
+            long long depth = LaneSize((VehicleClass)lane);
+            if (this->metrics != nullptr) this->metrics->lanes[lane].queued -= tally.mergedDepth;
+            if (metrics != nullptr) metrics->lanes[lane].queued += depth;
+            tally.mergedDeparted = tally.departedAtGreenEnd = departed[lane];
+            tally.mergedRemoved = tally.removed;
+            tally.mergedDepth = depth;
+            deepest[lane] = depth; // e.g. a restored lane
+        }
+        this->metrics = metrics;
+        nextGreenEnd = 0;
+    }
+
+    // Adds the lane tallies since the last merge to metrics (from the thread that owns it)
+    void mergeMetrics() {
+        if (metrics == nullptr) return;
+        for (int lane = 0; lane < 3; lane++) {
+            LaneTally& tally = tallies[lane];
+            long long depth = LaneSize((VehicleClass)lane);
+            long long departures = departed[lane] - tally.mergedDeparted;
+            long long arrivals = departures + (tally.removed - tally.mergedRemoved) + (depth - tally.mergedDepth);
+            metrics->lanes[lane].addTally(arrivals, departures, depth - tally.mergedDepth, max(deepest[lane], depth));
+            tally.mergedDeparted = departed[lane];
+            tally.mergedRemoved = tally.removed;
+            tally.mergedDepth = depth;
+        }
+    }
+
+    // Lets a metrics reader see the counts so far: when one has asked, or always with
+    // force. For a road with its own RoadMetrics; a grid merges all its roads first.
+    void publishMetrics(bool force = false) {
+        if (metrics == nullptr || !(force || metrics->wanted.load(memory_order_relaxed))) return;
+        mergeMetrics();
+        metrics->publish();
+    }
+
+    // depth is the lane's depth just before the vehicle was taken out
+    void noteRemoval(VehicleClass lane, long long depth) {
+        if (metrics == nullptr) return;
+        tallies[lane].removed++;
+        if (depth > deepest[lane]) deepest[lane] = depth;
+    }
+
+    // Records every vehicle that leaves through logPass() (nullptr stops)
+    void attachPassLog(PassLogWriter* passLog) {
+        this->passLog = passLog;
+    }
+
+    // With passLog attached; kept apart from noteDeparture() so that one stays small enough to inline
+    void logPass(VehicleClass lane, const Vehicles& vehicle) {
+        PassRecord record = {(uint64_t)clock, vehicle.waitedAt(clock), intersection,
+                             (uint8_t)vehicle.type, (uint8_t)lane};
+        passLog->record(record);
+    }
+
+    // With metrics attached; depth is the lane's depth just before the vehicle left
+    void noteDeparture(VehicleClass lane, long long depth, uint32_t waited) {
+        departed[lane]++;
+        if (depth > deepest[lane]) deepest[lane] = depth;
+        metrics->lanes[lane].onWait(waited);
+    }
+
+    // For callers that keep signals outside the road (the city grid)
+    void noteGreenEnds(VehicleClass lane, long long count) {
+        if (metrics == nullptr || count <= 0) return;
+        LaneTally& tally = tallies[lane];
+        for (long long i = 0; i < count; i++) metrics->lanes[lane].onGreenEnd(i == 0 ? departed[lane] - tally.departedAtGreenEnd : 0);
+        tally.departedAtGreenEnd = departed[lane];
+    }
+
+    bool DequeueVehiclesFromLanes(string LaneType) {
+        VehicleClass lane = parseVehicleClass(LaneType);
+        if (lane == INVALID_VEHICLE) return false;
+        return DequeueVehiclesFromLanes(lane);
+    }
+
+    // Hands the front vehicle of a green lane to the caller instead of logging it
+    bool ReleaseVehicle(VehicleClass lane, Vehicles& out) {
+        if (!signals[lane]->canPass()) return false;
+        return TakeVehicle(lane, out);
+    }
+
+    void setSignalTimings(int redTime, int greenTime, int yellowTime) {
+        TruckSignal.setTimings(redTime, greenTime, yellowTime);
+        CarSignal.setTimings(redTime, greenTime, yellowTime);
+        BikeSignal.setTimings(redTime, greenTime, yellowTime);
+        nextGreenEnd = 0;
+    }
+
+    TrafficSignal& SignalForLane(VehicleClass lane) {
+        return *signals[lane];
+    }
+
+    bool LaneCanPass(VehicleClass lane) {
+        return signals[lane]->canPass();
+    }
+
+    // With metrics attached, green phases are only counted on updates that reach
+    // nextGreenEnd, which is also when a waiting metrics reader gets its copy
+    void updateAllSignals(long long elapsedTime) {
+        if (elapsedTime > 0) clock += elapsedTime;
+        bool greenEnds = metrics != nullptr && clock >= nextGreenEnd;
+        if (greenEnds) {
+            for (int lane = 0; lane < 3; lane++) noteGreenEnds((VehicleClass)lane, signals[lane]->greenEndsWithin(elapsedTime));
+            publishMetrics();
+        }
+        TruckSignal.changeSignal(elapsedTime);
+        CarSignal.changeSignal(elapsedTime);
+        BikeSignal.changeSignal(elapsedTime);
+        if (greenEnds) {
+            long long soonest = signals[0]->secondsToGreenEnd();
+            for (int lane = 1; lane < 3; lane++) soonest = min(soonest, signals[lane]->secondsToGreenEnd());
+            nextGreenEnd = clock + soonest;
+        }
+    }
+
+    void displayAllSignals() {
+        cout << "\nTruck lane Signal: ";
+        TruckSignal.displaySignal();
+
+        cout << "Car Lane Signal: ";
+        CarSignal.displaySignal();
+
+        cout << "Bike lane Signal: ";
+        BikeSignal.displaySignal();
+    }
+};
+
+// An intersection whose three lanes are all of type Lane. A lane type needs
+// Enqueue(Vehicles), Dequeue(Vehicles*), Pop(Vehicles&), Peek(), Size(), Display(),
+// CopyTo(char*), Restore(records, count) and a static Name(). The class is final, so code holding a Road<Lane> gets these
+// calls inlined with no per-call branching on the lane type.
+template <class Lane>
+class Road final : public RoadBase {
+public:
+    Lane TruckLane;
+    Lane CarLane;
+    Lane BikeLane;
+
+    // Lanes indexed by VehicleClass
+    Lane* lanes[3];
+
+    Road() : RoadBase(Lane::InputMode) {
+        lanes[TRUCK] = &TruckLane;
+        lanes[CAR] = &CarLane;
+        lanes[BIKE] = &BikeLane;
+    }
+
+    const char* LaneName() override {
+        return Lane::Name();
+    }
+
+    bool AddVehiclesToLane(Vehicles vehicle) override {
+        if (vehicle.type >= INVALID_VEHICLE) {
+            if (!quietMode) cout << "Invalid vehicle type. Please enter Truck, Car, or Bike." << endl;
+            return false;
+        }
+        vehicle.arrivalTime = (uint32_t)clock; // low 32 bits, see Vehicles
+        return lanes[vehicle.type]->Enqueue(vehicle);
+    }
+
+    using RoadBase::DequeueVehiclesFromLanes;
+
+    bool DequeueVehiclesFromLanes(VehicleClass lane, Vehicles* passed = nullptr) override {
+        if (!signals[lane]->canPass()) {
+            if (!quietMode) cout << laneTypes[lane] << " Lane Signal is not Green! Please wait" << endl;
+            return false;
+        }
+        Lane& queue = *lanes[lane];
+        // recorded from the front of the lane, so the vehicle is not copied out for it
+        if (queue.Size() > 0) {
+            if (metrics != nullptr) noteDeparture(lane, queue.Size(), queue.Peek().waitedAt(clock));
+            if (passLog != nullptr) logPass(lane, queue.Peek());
+        }
+        return queue.Dequeue(passed);
+    }
+
+    bool TakeVehicle(VehicleClass lane, Vehicles& out) override {
+        if (!lanes[lane]->Pop(out)) return false;
+        if (metrics != nullptr) noteDeparture(lane, lanes[lane]->Size() + 1, out.waitedAt(clock));
+        if (passLog != nullptr) logPass(lane, out);
+        return true;
+    }
+
+    int LaneSize(VehicleClass lane) override {
+        return lanes[lane]->Size();
+    }
+
+    bool setLaneCapacity(size_t capacity, bool growable) override {
+        bool changed = true;
+        for (Lane* lane : lanes) changed = configureLaneCapacity(*lane, capacity, growable) && changed;
+        return changed;
+    }
+
+    string LaneStats(VehicleClass lane) override {
+        return laneStats(*lanes[lane]);
+    }
+
+    void saveLanes(SnapshotWriter& out) override {
+        out.put((int64_t)clock);
+        for (Lane* lane : lanes) lane->CopyTo(out.putArray<Vehicles>(lane->Size()));
+    }
+
+    bool loadLanes(SnapshotReader& in) override {
+        clock = in.get<int64_t>();
+        for (Lane* lane : lanes) {
+            size_t count;
+            const char* records = in.getArray<Vehicles>(count);
+            if (!in.ok() || !lane->Restore(records, count)) return false;
+        }
+        return true;
+    }
+
+    void enableVehicleIndex() override {
+        for (Lane* lane : lanes) lane->EnableIndex();
+    }
+
+    VehicleClass LocateVehicle(uint64_t id, Vehicles* record = nullptr) override {
+        Vehicles found;
+        for (int type = TRUCK; type <= BIKE; type++) {
+            if (lanes[type]->Find(id, found)) {
+                if (record != nullptr) *record = found;
+                return (VehicleClass)type;
+            }
+        }
+        return INVALID_VEHICLE;
+    }
+
+    bool RemoveVehicle(uint64_t id) override {
+        for (int type = TRUCK; type <= BIKE; type++) {
+            long long depth = lanes[type]->Size();
+            if (lanes[type]->Remove(id)) {
+                noteRemoval((VehicleClass)type, depth);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool PromoteVehicle(uint64_t id) override {
+        for (Lane* lane : lanes) {
+            if (lane->Promote(id)) return true;
+        }
+        return false;
+    }
+
+    void DisplayAllLanes(const DisplayOptions& options = DisplayOptions()) override {
+        static const char* titles[3] = {"\nTrucks Lane (", "\nCars Lane (", "\nBikes Lane ("};
+        LaneRenderer& out = consoleRenderer;
+        size_t total = 0;
+        for (int type = TRUCK; type <= BIKE; type++) {
+            size_t size = (size_t)lanes[type]->Size();
+            total += size;
+            out.text(titles[type]).text(Lane::Name()).text("): ");
+            if (options.view == VIEW_SUMMARY) {
+                out.number(size).text(" vehicles");
+                continue;
+            }
+            size_t first = 0;
+            if (options.view == VIEW_TAIL && size > options.count) first = size - options.count;
+            if (options.view == VIEW_PAGE) first = options.page * options.count;
+            size_t shown = first < size ? min(options.count, size - first) : 0;
+            if (shown < size) {
+                if (shown == 0) out.text("none on this page (the lane holds ").number(size).text(")");
+                else out.text("vehicles ").number(first + 1).text("-").number(first + shown).text(" of ").number(size).text(":");
+            }
+            lanes[type]->VisitRange(first, shown, [&out](const Vehicles& vehicle) { out.vehicle(vehicle); });
+        }
+        if (options.view == VIEW_SUMMARY) out.text("\nTotal: ").number(total).text(" vehicles");
+        out.text("\n").write();
+    }
+};
+
+// Runtime factory behind the menu's lane choice
+RoadBase* makeRoad(int inputMode) {
+    if (inputMode == 2) return new Road<ArrayQue>();
+    return new Road<ListQue>();
+}
+
+int chooseInputMode() {
+    int inputMode;
+    cout << "1. Use Linked List." << endl;
+    cout << "2. Use Array." << endl;
+    cout << "Enter choice: ";
+    cin >> inputMode;
+    if (inputMode != 1 && inputMode != 2) {
+        cout << "Invalid choice. Defaulting to Linked List." << endl;
+        inputMode = 1;
+    } else {
+        cout << (inputMode == 1 ? "Using Linked List" : "Using Array") << " for lane management." << endl;
+    }
+    return inputMode;
+}
+
+// One line of a batch trace:
+//   A <id> <type>   vehicle arrives at its lane
+//   D <lane>        operator releases one vehicle from a lane
+//   T <seconds>     signals advance by the given time
+//   P <id>          vehicle is moved to the front of its lane (emergency)
+//   R <id>          vehicle leaves its lane without passing the signal
+// Plates and lane names are resolved when the trace is loaded.
+struct TraceEvent {
+    char kind;
+    VehicleClass lane;
+    int seconds;
+    uint64_t id;
+};
+
+class BatchSimulator {
+public:
+    vector<TraceEvent> events;
+
+    long long arrived[3] = {0, 0, 0};
+    long long rejected[3] = {0, 0, 0};
+    long long passed[3] = {0, 0, 0};
+    long long heldAtRed[3] = {0, 0, 0};
+    long long emptyLane[3] = {0, 0, 0};
+    long long invalidEvents = 0;
+    long long promoted = 0;
+    long long removedById = 0;
+    long long unknownIds = 0; // P/R events naming a vehicle that is not queued
+    bool usesIds = false; // trace has P/R events, so the road needs its vehicle index
+    long long simulatedSeconds = 0;
+    double loadMs = 0;
+    double runMs = 0;
+
+    bool loadTrace(const string& fileName) {
+        auto startTime = chrono::steady_clock::now();
+        ifstream file(fileName);
+        if (!file.is_open()) {
+            cout << "Error: Unable to open trace file " << fileName << endl;
+            return false;
+        }
+        string line;
+        while (getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            istringstream in(line);
+            TraceEvent event = {' ', INVALID_VEHICLE, 0, 0};
+            string plate, type;
+            in >> event.kind;
+            if (event.kind == 'A') {
+                in >> plate >> type;
+            } else if (event.kind == 'D') {
+                in >> type;
+            } else if (event.kind == 'T') {
+                in >> event.seconds;
+            } else if (event.kind == 'P' || event.kind == 'R') {
+                in >> plate;
+            }
+            bool byId = event.kind == 'P' || event.kind == 'R';
+            if (event.kind == 'A' || event.kind == 'D') event.lane = parseVehicleClass(type);
+            if (!in || (event.kind != 'T' && !byId && event.lane == INVALID_VEHICLE)) {
+                invalidEvents++;
+                continue;
+            }
+            if (event.kind == 'A' || byId) event.id = plateRegistry.intern(plate);
+            if (byId) usesIds = true;
+            events.push_back(event);
+        }
+        loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        return true;
+    }
+
+    // Roughly even arrivals and releases with a one second signal tick every ten events
+    void generateTrace(long long count, unsigned seed) {
+        auto startTime = chrono::steady_clock::now();
+        mt19937 rng(seed);
+        uniform_int_distribution<int> pick(0, 99);
+        uniform_int_distribution<int> lane(0, 2);
+        events.reserve(events.size() + count);
+        long long nextId = 1;
+        for (long long i = 0; i < count; i++) {
+            int roll = pick(rng);
+            TraceEvent event = {' ', INVALID_VEHICLE, 0, 0};
+            if (roll < 45) {
+                event.kind = 'A';
+                event.id = (uint64_t)nextId++;
+                event.lane = (VehicleClass)lane(rng);
+            } else if (roll < 90) {
+                event.kind = 'D';
+                event.lane = (VehicleClass)lane(rng);
+            } else {
+                event.kind = 'T';
+                event.seconds = 1;
+            }
+            events.push_back(event);
+        }
+        loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    }
+
+    bool writeTrace(const string& fileName) {
+        ofstream file(fileName);
+        if (!file.is_open()) {
+            cout << "Error: Unable to open trace file " << fileName << " for writing" << endl;
+            return false;
+        }
+        for (const TraceEvent& event : events) {
+            if (event.kind == 'A') file << "A " << plateRegistry.plateOf(event.id) << ' ' << laneTypes[event.lane] << '\n';
+            else if (event.kind == 'D') file << "D " << laneTypes[event.lane] << '\n';
+            else if (event.kind == 'P' || event.kind == 'R') file << event.kind << ' ' << plateRegistry.plateOf(event.id) << '\n';
+            else file << "T " << event.seconds << '\n';
+        }
+        return true;
+    }
+
+    template <class RoadType>
+    void run(RoadType& road) {
+        auto startTime = chrono::steady_clock::now();
+        for (const TraceEvent& event : events) {
+            if (event.kind == 'A') {
+                if (road.AddVehiclesToLane(Vehicles(event.id, event.lane))) arrived[event.lane]++;
+                else rejected[event.lane]++;
+            } else if (event.kind == 'D') {
+                if (road.DequeueVehiclesFromLanes(event.lane)) passed[event.lane]++;
+                else if (!road.LaneCanPass(event.lane)) heldAtRed[event.lane]++;
+                else emptyLane[event.lane]++;
+            } else if (event.kind == 'T') {
+                road.updateAllSignals(event.seconds);
+                simulatedSeconds += event.seconds;
+            } else if (event.kind == 'P') {
+                if (road.PromoteVehicle(event.id)) promoted++;
+                else unknownIds++;
+            } else if (event.kind == 'R') {
+                if (road.RemoveVehicle(event.id)) removedById++;
+                else unknownIds++;
+            } else {
+                invalidEvents++;
+            }
+        }
+        road.publishMetrics(true);
+        runMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    }
+
+    void printReport(RoadBase& road) {
+        double seconds = runMs / 1000.0;
+        cout << "\nBatch Simulation Report (" << road.LaneName() << " lanes)" << endl;
+        cout << "Events processed: " << events.size() << " (invalid: " << invalidEvents << ")" << endl;
+        cout << "Simulated time: " << simulatedSeconds << " seconds" << endl;
+        if (usesIds) {
+            cout << "Promoted: " << promoted << ", removed by ID: " << removedById << ", not queued: " << unknownIds << endl;
+        }
+        cout << "Trace load time: " << loadMs << " ms" << endl;
+        cout << "Total runtime: " << runMs << " ms" << endl;
+        cout << "Throughput: " << (seconds > 0 ? events.size() / seconds : 0) << " events/sec" << endl;
+        cout << "\nLane    Arrived   Rejected  Passed    HeldRed   Empty     Queued" << endl;
+        for (int i = 0; i < 3; i++) {
+            cout << laneTypes[i];
+            for (size_t pad = laneTypes[i].size(); pad < 8; pad++) cout << ' ';
+            long long values[6] = {arrived[i], rejected[i], passed[i], heldAtRed[i], emptyLane[i], (long long)road.LaneSize((VehicleClass)i)};
+            for (long long value : values) {
+                string text = to_string(value);
+                cout << text;
+                for (size_t pad = text.size(); pad < 10; pad++) cout << ' ';
+            }
+            cout << endl;
+        }
+        for (int i = 0; i < 3; i++) {
+            cout << laneTypes[i] << " lane: " << road.LaneStats((VehicleClass)i) << endl;
+        }
+    }
+};
+
+// Times one lane for the pool benchmark. "churn" keeps the lane at a steady depth
+// with one enqueue and one dequeue per step; "burst" fills the lane to depth and
+// drains it again, which is where per-node new/delete hurts the most.
+double timeListQue(bool pooled, bool burst, long long ops, int depth, long long& highWater) {
+    ListQue lane(pooled);
+    Vehicles vehicle("V1", "Car");
+    auto startTime = chrono::steady_clock::now();
+    long long done = 0;
+    if (burst) {
+        while (done < ops) {
+            for (int i = 0; i < depth; i++) lane.Enqueue(vehicle);
+            for (int i = 0; i < depth; i++) lane.Dequeue();
+            done += 2LL * depth;
+        }
+    } else {
+        for (int i = 0; i < depth; i++) lane.Enqueue(vehicle);
+        for (; done < ops; done += 2) {
+            lane.Enqueue(vehicle);
+            lane.Dequeue();
+        }
+        lane.Clear();
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+    highWater = lane.PoolHighWaterMark();
+    return ns / done;
+}
+
+// Peak resident set size in KB (0 when the platform does not report it)
+long long peakRssKb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (long long)(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return atoll(line.c_str() + 6);
+    }
+    return 0;
+#endif
+}
+
+// Lets each benchmark case report its own peak; only Linux supports resetting it
+void resetPeakRss() {
+#if defined(__linux__)
+    ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs.is_open()) clearRefs << "5";
+#endif
+}
+
+// std::allocator that counts allocate() calls into a counter its owner keeps
+template <class T>
+struct CountingAllocator {
+    typedef T value_type;
+    long long* count;
+
+    explicit CountingAllocator(long long* count) : count(count) {}
+    template <class U> CountingAllocator(const CountingAllocator<U>& other) : count(other.count) {}
+
+    T* allocate(size_t n) {
+        (*count)++;
+        return allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* memory, size_t n) {
+        allocator<T>().deallocate(memory, n);
+    }
+
+    template <class U> bool operator==(const CountingAllocator<U>& other) const { return count == other.count; }
+    template <class U> bool operator!=(const CountingAllocator<U>& other) const { return count != other.count; }
+};
+
+// std::deque with the lane interface, as a reference point for the benchmark
+class DequeLane {
+    long long allocations;
+    deque<Vehicles, CountingAllocator<Vehicles>> vehicles;
+
+public:
+    DequeLane() : allocations(0), vehicles(CountingAllocator<Vehicles>(&allocations)) {}
+    DequeLane(const DequeLane&) = delete;
+    DequeLane& operator=(const DequeLane&) = delete;
+
+    long long HeapAllocations() {
+        return allocations;
+    }
+
+    bool Enqueue(Vehicles vehicle) {
+        vehicles.push_back(vehicle);
+        return true;
+    }
+
+    bool Pop(Vehicles& out) {
+        if (vehicles.empty()) return false;
+        out = vehicles.front();
+        vehicles.pop_front();
+        return true;
+    }
+
+    int Size() {
+        return (int)vehicles.size();
+    }
+};
+
+struct LaneBenchResult {
+    long long ops;
+    double nsPerOp;
+    double p50Ns;
+    double p99Ns;
+    long long peakRssKb;
+    double allocsPerOp;
+};
+
+// Latency is sampled per batch of latencyBatch operations, since a clock read
+// costs about as much as a single enqueue; p50/p99 are per-operation averages
+// within those batches.
+const int latencyBatch = 32;
+
+// Runs one workload on one lane. Workloads:
+//   steady - lane held at `size` vehicles, alternating enqueue and dequeue
+//   burst  - fill to `size`, drain to empty, repeat
+//   drain  - dequeue `size` vehicles from a full lane (the fill is not timed)
+//   mixed  - random enqueues and dequeues starting from `size` vehicles
+template <class Lane>
+LaneBenchResult benchLane(Lane& lane, const string& workload, long long size, long long targetOps) {
+    vector<uint8_t> plan; // 1 = enqueue, 0 = dequeue
+    if (workload == "steady") {
+        for (long long i = 0; i < targetOps; i++) plan.push_back(i % 2 == 0);
+    } else if (workload == "burst") {
+        long long rounds = max(1LL, targetOps / (2 * size));
+        for (long long r = 0; r < rounds; r++) {
+            plan.insert(plan.end(), size, 1);
+            plan.insert(plan.end(), size, 0);
+        }
+    } else if (workload == "drain") {
+        plan.assign(size, 0);
+    } else {
+        minstd_rand rng(7);
+        for (long long i = 0; i < targetOps; i++) plan.push_back(rng() % 2);
+    }
+    long long prefill = (workload == "burst") ? 0 : size;
+
+    resetPeakRss();
+    Vehicles vehicle(1, CAR), out;
+    for (long long i = 0; i < prefill; i++) lane.Enqueue(vehicle);
+
+    vector<double> samples;
+    samples.reserve(plan.size() / latencyBatch + 1);
+    long long allocationsBefore = lane.HeapAllocations();
+    auto startTime = chrono::steady_clock::now();
+    auto batchStart = startTime;
+    for (size_t i = 0; i < plan.size(); i++) {
+        if (plan[i]) {
+            vehicle.id = i;
+            lane.Enqueue(vehicle);
+        } else {
+            lane.Pop(out);
+        }
+        if ((i + 1) % latencyBatch == 0) {
+            auto now = chrono::steady_clock::now();
+            samples.push_back(chrono::duration<double, nano>(now - batchStart).count() / latencyBatch);
+            batchStart = now;
+        }
+    }
+    double totalNs = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+    long long allocations = lane.HeapAllocations() - allocationsBefore;
+
+    LaneBenchResult result;
+    result.ops = (long long)plan.size();
+    result.nsPerOp = result.ops ? totalNs / result.ops : 0;
+    sort(samples.begin(), samples.end());
+    result.p50Ns = samples.empty() ? result.nsPerOp : samples[samples.size() / 2];
+    result.p99Ns = samples.empty() ? result.nsPerOp : samples[min(samples.size() - 1, samples.size() * 99 / 100)];
+    result.peakRssKb = peakRssKb();
+    result.allocsPerOp = result.ops ? (double)allocations / result.ops : 0;
+    while (lane.Pop(out)) {
+    }
+    return result;
+}
+
+void writeLaneBenchRow(ostream& out, const string& label, const string& laneName, const string& workload,
+                       long long size, const LaneBenchResult& result) {
+    out << label << ',' << laneName << ',' << workload << ',' << size << ',' << result.ops << ','
+        << result.nsPerOp << ',' << result.p50Ns << ',' << result.p99Ns << ','
+        << result.peakRssKb << ',' << result.allocsPerOp << '\n';
+}
+
+int runLaneBenchmark(int argc, char* argv[]) {
+    string csvFile, label = "local";
+    vector<long long> sizes = {1000, 100000, 1000000};
+    long long targetOps = 4000000;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--csv" && i + 1 < argc) {
+            csvFile = argv[++i];
+        } else if (arg == "--label" && i + 1 < argc) {
+            label = argv[++i];
+        } else if (arg == "--ops" && i + 1 < argc) {
+            targetOps = atoll(argv[++i]);
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            stringstream list(argv[++i]);
+            string item;
+            while (getline(list, item, ',')) {
+                if (atoll(item.c_str()) > 0) sizes.push_back(atoll(item.c_str()));
+            }
+        } else {
+            cout << "Usage: Traffic_Management --bench-lanes [--csv <file>] [--label <name>] [--sizes 1000,100000] [--ops N]" << endl;
+            return 1;
+        }
+    }
+    if (sizes.empty() || targetOps <= 0) {
+        cout << "Need at least one size and a positive operation count." << endl;
+        return 1;
+    }
+    quietMode = true;
+    passedLog.setEnabled(false);
+
+    // Appending to an existing CSV keeps one file of results across commits
+    ofstream csv;
+    bool needHeader = true;
+    if (!csvFile.empty()) {
+        needHeader = !ifstream(csvFile).good();
+        csv.open(csvFile, ios::app);
+        if (!csv.is_open()) {
+            cout << "Error: Unable to open " << csvFile << endl;
+            return 1;
+        }
+    }
+    ostream& out = csv.is_open() ? (ostream&)csv : cout;
+    if (needHeader) out << "label,lane,workload,size,ops,ns_per_op,p50_ns,p99_ns,peak_rss_kb,allocs_per_op\n";
+
+    const string workloads[4] = {"steady", "burst", "drain", "mixed"};
+    for (long long size : sizes) {
+        for (const string& workload : workloads) {
+            {
+                ListQue lane(true);
+                writeLaneBenchRow(out, label, "ListQue-pooled", workload, size, benchLane(lane, workload, size, targetOps));
+            }
+            {
+                ListQue lane(false);
+                writeLaneBenchRow(out, label, "ListQue-new-delete", workload, size, benchLane(lane, workload, size, targetOps));
+            }
+            {
+                ArrayQue lane;
+                writeLaneBenchRow(out, label, "ArrayQue-ring", workload, size, benchLane(lane, workload, size, targetOps));
+            }
+            {
+                DequeLane lane;
+                writeLaneBenchRow(out, label, "std-deque", workload, size, benchLane(lane, workload, size, targetOps));
+            }
+            out.flush();
+        }
+    }
+    if (csv.is_open()) cout << "Results appended to " << csvFile << endl;
+    return 0;
+}
+
+int runPoolBenchmark(int argc, char* argv[]) {
+    long long ops = argc > 2 ? atoll(argv[2]) : 10000000;
+    int depth = argc > 3 ? atoi(argv[3]) : 10000;
+    if (ops <= 0 || depth <= 0) {
+        cout << "Usage: Traffic_Management --bench-pool [operations] [lane depth]" << endl;
+        return 1;
+    }
+    quietMode = true;
+    passedLog.setEnabled(false);
+
+    cout << "ListQue node allocation benchmark: " << ops << " operations, lane depth " << depth << endl;
+    cout << "Workload  new/delete (ns/op)  pooled (ns/op)  speedup  pool high-water" << endl;
+    const char* names[2] = {"churn", "burst"};
+    for (int burst = 0; burst < 2; burst++) {
+        long long unusedHighWater, highWater;
+        double plain = timeListQue(false, burst == 1, ops, depth, unusedHighWater);
+        double pooled = timeListQue(true, burst == 1, ops, depth, highWater);
+        cout << names[burst] << "     " << plain << "              " << pooled
+             << "          " << plain / pooled << "x    " << highWater << endl;
+    }
+    return 0;
+}
+
+// Steady-depth churn (one enqueue and one dequeue per step) with the vehicle
+// index off or on, to show what keeping the index costs the common path.
+template <class Lane>
+double timeIndexedChurn(bool indexed, long long ops, int depth) {
+    Lane lane;
+    if (indexed) lane.EnableIndex();
+    uint64_t nextId = 1;
+    for (int i = 0; i < depth; i++) lane.Enqueue(Vehicles(nextId++, CAR));
+    auto startTime = chrono::steady_clock::now();
+    long long done = 0;
+    for (; done < ops; done += 2) {
+        lane.Enqueue(Vehicles(nextId++, CAR));
+        lane.Dequeue();
+    }
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count() / done;
+}
+
+// Random enqueue/dequeue/find/promote/remove against a std::list model. The lane
+// order is compared in full every few hundred operations. Returns false on the
+// first mismatch.
+template <class Lane>
+bool checkIndexedLane(long long ops, unsigned seed) {
+    Lane lane;
+    lane.EnableIndex();
+    list<uint64_t> model;
+    unordered_map<uint64_t, list<uint64_t>::iterator> where;
+    mt19937 rng(seed);
+    uint64_t nextId = 1;
+    vector<char> records;
+    for (long long op = 0; op < ops; op++) {
+        int roll = (int)(rng() % 100);
+        uint64_t id = nextId > 1 ? 1 + rng() % (nextId - 1) : 0; // may already be gone
+        Vehicles found;
+        bool ok;
+        if (roll < 40) {
+            lane.Enqueue(Vehicles(nextId, CAR));
+            where[nextId] = model.insert(model.end(), nextId);
+            nextId++;
+            ok = true;
+        } else if (roll < 60) {
+            ok = lane.Dequeue(&found) == !model.empty();
+            if (!model.empty()) {
+                ok = ok && found.id == model.front();
+                where.erase(model.front());
+                model.pop_front();
+            }
+        } else if (roll < 75) {
+            bool queued = where.count(id) > 0;
+            ok = lane.Find(id, found) == queued && (!queued || found.id == id);
+        } else if (roll < 90) {
+            bool queued = where.count(id) > 0;
+            ok = lane.Promote(id) == queued;
+            if (queued) model.splice(model.begin(), model, where[id]);
+        } else {
+            bool queued = where.count(id) > 0;
+            ok = lane.Remove(id) == queued;
+            if (queued) {
+                model.erase(where[id]);
+                where.erase(id);
+            }
+        }
+        if (!ok || lane.Size() != (int)model.size()) return false;
+        if (op % 256 == 255 || op == ops - 1) {
+            records.resize(model.size() * sizeof(Vehicles));
+            lane.CopyTo(records.data());
+            const Vehicles* vehicles = (const Vehicles*)records.data();
+            size_t i = 0;
+            for (uint64_t expected : model) {
+                if (vehicles[i++].id != expected) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Per-operation cost of the ID lookups on a lane holding depth vehicles, each
+// vehicle touched once in random order: find, then promote, then remove.
+template <class Lane>
+void timeIndexedLookups(int depth, unsigned seed, double ns[3]) {
+    Lane lane;
+    lane.EnableIndex();
+    vector<uint64_t> ids(depth);
+    for (int i = 0; i < depth; i++) {
+        ids[i] = (uint64_t)i + 1;
+        lane.Enqueue(Vehicles(ids[i], CAR));
+    }
+    shuffle(ids.begin(), ids.end(), mt19937(seed));
+    Vehicles found;
+    long long hits = 0;
+    auto startTime = chrono::steady_clock::now();
+    for (uint64_t id : ids) hits += lane.Find(id, found);
+    auto looked = chrono::steady_clock::now();
+    for (uint64_t id : ids) hits += lane.Promote(id);
+    auto promoted = chrono::steady_clock::now();
+    for (uint64_t id : ids) hits += lane.Remove(id);
+    auto removed = chrono::steady_clock::now();
+    ns[0] = chrono::duration<double, nano>(looked - startTime).count() / depth;
+    ns[1] = chrono::duration<double, nano>(promoted - looked).count() / depth;
+    ns[2] = chrono::duration<double, nano>(removed - promoted).count() / depth;
+    if (hits != 3LL * depth || lane.Size() != 0) ns[0] = ns[1] = ns[2] = -1;
+}
+
+template <class Lane>
+bool benchmarkIndexedLane(long long ops, int depth, unsigned seed) {
+    double plain = timeIndexedChurn<Lane>(false, ops, depth);
+    double indexed = timeIndexedChurn<Lane>(true, ops, depth);
+    double ns[3];
+    timeIndexedLookups<Lane>(depth, seed, ns);
+    bool correct = checkIndexedLane<Lane>(ops / 10, seed) && ns[0] >= 0;
+    cout << Lane::Name() << "     " << plain << "        " << indexed << "        "
+         << ns[0] << "     " << ns[1] << "        " << ns[2] << "       " << (correct ? "ok" : "MISMATCH") << endl;
+    return correct;
+}
+
+int runIndexBenchmark(int argc, char* argv[]) {
+    long long ops = argc > 2 ? atoll(argv[2]) : 4000000;
+    int depth = argc > 3 ? atoi(argv[3]) : 100000;
+    unsigned seed = argc > 4 ? (unsigned)atoi(argv[4]) : 7;
+    if (ops <= 0 || depth <= 0) {
+        cout << "Usage: Traffic_Management --bench-index [operations] [lane depth] [seed]" << endl;
+        return 1;
+    }
+    quietMode = true;
+    passedLog.setEnabled(false);
+
+    cout << "Vehicle ID index benchmark: " << ops << " churn operations, lane depth " << depth << endl;
+    cout << "Lane     churn (ns/op)  indexed (ns/op)  find (ns)  promote (ns)  remove (ns)  model check" << endl;
+    bool correct = benchmarkIndexedLane<ListQue>(ops, depth, seed);
+    correct = benchmarkIndexedLane<ArrayQue>(ops, depth, seed) && correct;
+    return correct ? 0 : 1;
+}
+
+// Discards everything written to it; lets the render benchmark time the
+// formatting and the write call without a terminal in the way
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+template <class Lane>
+void timeLaneRendering(long long vehicles) {
+    Road<Lane> road;
+    for (long long i = 0; i < vehicles; i++) {
+        for (int type = TRUCK; type <= BIKE; type++) road.AddVehiclesToLane(Vehicles((uint64_t)(i * 3 + type), (VehicleClass)type));
+    }
+    DisplayOptions views[6];
+    const char* names[6] = {"summary", "head 20", "tail 20", "middle page", "next page", "everything"};
+    views[0].view = VIEW_SUMMARY;
+    views[2].view = VIEW_TAIL;
+    views[3].view = views[4].view = VIEW_PAGE;
+    views[3].page = (size_t)vehicles / 2 / views[3].count;
+    views[4].page = views[3].page + 1;
+    views[5].count = (size_t)vehicles;
+    NullBuffer discard;
+    for (int v = 0; v < 6; v++) {
+        streambuf* console = cout.rdbuf(&discard);
+        auto startTime = chrono::steady_clock::now();
+        road.DisplayAllLanes(views[v]);
+        double us = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+        cout.rdbuf(console);
+        cout << Lane::Name() << "  " << names[v] << ": " << us << " us" << endl;
+    }
+}
+
+int runRenderBenchmark(int argc, char* argv[]) {
+    long long vehicles = argc > 2 ? atoll(argv[2]) : 1000000;
+    if (vehicles <= 0) {
+        cout << "Usage: Traffic_Management --bench-render [vehicles per lane]" << endl;
+        return 1;
+    }
+    quietMode = true;
+    passedLog.setEnabled(false);
+    cout << "Lane display benchmark: " << vehicles << " vehicles in each of the 3 lanes" << endl;
+    timeLaneRendering<ListQue>(vehicles);
+    timeLaneRendering<ArrayQue>(vehicles);
+    return 0;
+}
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped, so a
+// restore copies lane records straight out of the page cache; elsewhere it is read
+// into memory in one go.
+class MappedFile {
+    const char* data;
+    size_t size;
+#if defined(_WIN32)
+    vector<char> contents;
+#else
+    void* mapping;
+#endif
+
+public:
+    MappedFile() {
+        data = nullptr;
+        size = 0;
+#if !defined(_WIN32)
+        mapping = nullptr;
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // sequential tells the kernel to read ahead; turn it off when only parts of the file are read
+    bool open(const string& path, bool sequential = true) {
+#if defined(_WIN32)
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) return false;
+        contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = contents.data();
+        size = contents.size();
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+        size = (size_t)info.st_size;
+        if (size > 0) {
+            mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) mapping = nullptr;
+            else madvise(mapping, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        }
+        close(fd);
+        if (size > 0 && mapping == nullptr) return false;
+        data = (const char*)mapping;
+        return true;
+#endif
+    }
+
+    const char* Data() { return data; }
+    size_t Size() { return size; }
+
+    ~MappedFile() {
+#if !defined(_WIN32)
+        if (mapping != nullptr) munmap(mapping, size);
+#endif
+    }
+};
+
+// Filters for --query-log
+struct PassQuery {
+    uint64_t from = 0;
+    uint64_t to = UINT64_MAX;
+    int vehicleClass = -1;        // a VehicleClass, or -1 for all of them
+    long long intersection = -1;  // or -1 for all of them
+    bool fullScan = false;        // decode and checksum every block, ignoring the headers
+};
+
+struct PassQueryResult {
+    long long blocks = 0;
+    long long skipped = 0;        // ruled out by the block header
+    long long headerOnly = 0;     // answered from the block header alone
+    long long decoded = 0;
+    long long decodedBytes = 0;   // column bytes actually read
+    long long matched = 0;
+    vector<uint64_t> waitCounts;  // matched vehicles per wait in seconds
+    string problem;               // set when a block is truncated or fails its checksum
+};
+
+// Exact counts are kept for waits up to this (about 48 days); longer waits are counted at the cap
+const uint32_t passQueryWaitCap = 1u << 22;
+
+void addWaits(PassQueryResult& result, uint32_t wait, uint64_t count) {
+    wait = min(wait, passQueryWaitCap);
+    if (wait >= result.waitCounts.size()) result.waitCounts.resize(wait + 1, 0);
+    result.waitCounts[wait] += count;
+}
+
+// Decodes a varint column of count values into out; delta columns are zigzag changes from base
+bool decodePassColumn(const unsigned char* in, size_t bytes, uint32_t count, bool delta, uint64_t base,
+                      vector<uint64_t>& out) {
+    const unsigned char* end = in + bytes;
+    out.resize(count);
+    uint64_t value;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!getVarint(in, end, value)) return false;
+        if (delta) base += (uint64_t)unzigzag(value);
+        out[i] = delta ? base : value;
+    }
+    return in == end;
+}
+
+void queryPassLog(const char* data, size_t size, const PassQuery& query, PassQueryResult& result) {
+    vector<uint64_t> times, waits, intersections;
+    size_t offset = sizeof(PassLogFileHeader);
+    while (offset < size) {
+        PassBlockHeader header;
+        if (size - offset < sizeof(header)) {
+            result.problem = "truncated block header";
+            return;
+        }
+        memcpy(&header, data + offset, sizeof(header));
+        uint64_t columnsSize = (uint64_t)header.columnBytes[0] + header.columnBytes[1] + header.columnBytes[2] + 2ULL * header.records;
+        if (memcmp(header.magic, passBlockMagic, sizeof(header.magic)) != 0 || columnsSize > size - offset - sizeof(header)) {
+            result.problem = "truncated or damaged block";
+            return;
+        }
+        const unsigned char* columns = (const unsigned char*)data + offset + sizeof(header);
+        offset += sizeof(header) + columnsSize;
+        result.blocks++;
+
+        bool byClass = query.vehicleClass >= 0;
+        bool byIntersection = query.intersection >= 0;
+        uint32_t classCount = byClass ? header.classCounts[query.vehicleClass] : header.records;
+        bool outside = header.maxTime < query.from || header.minTime > query.to || classCount == 0 ||
+                       (byIntersection && (query.intersection < header.minIntersection || query.intersection > header.maxIntersection));
+        if (outside && !query.fullScan) {
+            result.skipped++;
+            continue;
+        }
+
+        // columns the header cannot settle for this block
+        bool needTime = query.fullScan || header.minTime < query.from || header.maxTime > query.to;
+        bool needIntersection = query.fullScan || (byIntersection && (header.minIntersection != query.intersection ||
+                                                                      header.maxIntersection != query.intersection));
+        bool needClass = query.fullScan || (byClass && classCount != header.records);
+        if (!needTime && !needIntersection && !needClass && header.minWait == header.maxWait) {
+            result.headerOnly++;
+            result.matched += classCount;
+            addWaits(result, header.minWait, classCount);
+            continue;
+        }
+
+        result.decoded++;
+        if (query.fullScan && snapshotChecksum((const char*)columns, columnsSize) != header.checksum) {
+            result.problem = "block checksum mismatch";
+            return;
+        }
+        const unsigned char* timeColumn = columns;
+        const unsigned char* waitColumn = timeColumn + header.columnBytes[0];
+        const unsigned char* intersectionColumn = waitColumn + header.columnBytes[1];
+        const unsigned char* classColumn = intersectionColumn + header.columnBytes[2];
+        bool ok = decodePassColumn(waitColumn, header.columnBytes[1], header.records, false, 0, waits);
+        result.decodedBytes += header.columnBytes[1];
+        if (needTime) {
+            ok = ok && decodePassColumn(timeColumn, header.columnBytes[0], header.records, true, header.minTime, times);
+            result.decodedBytes += header.columnBytes[0];
+        }
+        if (needIntersection) {
+            ok = ok && decodePassColumn(intersectionColumn, header.columnBytes[2], header.records, true, header.minIntersection, intersections);
+            result.decodedBytes += header.columnBytes[2];
+        }
+        if (needClass) result.decodedBytes += header.records;
+        if (!ok) {
+            result.problem = "damaged column";
+            return;
+        }
+        for (uint32_t i = 0; i < header.records; i++) {
+            if (needTime && (times[i] < query.from || times[i] > query.to)) continue;
+            if (byIntersection && needIntersection && (long long)intersections[i] != query.intersection) continue;
+            if (byClass && needClass && classColumn[i] != query.vehicleClass) continue;
+            result.matched++;
+            addWaits(result, (uint32_t)waits[i], 1);
+        }
+    }
+}
+
+// Smallest wait with at least fraction of the matched vehicles at or below it
+uint64_t waitPercentile(const vector<uint64_t>& counts, uint64_t total, double fraction) {
+    uint64_t target = (uint64_t)(fraction * total + 0.999999);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t wait = 0; wait < counts.size(); wait++) {
+        seen += counts[wait];
+        if (seen >= target) return wait;
+    }
+    return counts.empty() ? 0 : counts.size() - 1;
+}
+
+int runPassLogQuery(int argc, char* argv[]) {
+    if (argc < 3) {
+        cout << "Usage: Traffic_Management --query-log <file> [--from <seconds>] [--to <seconds>]" << endl;
+        cout << "                             [--class Truck|Car|Bike] [--intersection N] [--full-scan]" << endl;
+        return 1;
+    }
+    string path = argv[2];
+    PassQuery query;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--from" && i + 1 < argc) query.from = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--to" && i + 1 < argc) query.to = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--intersection" && i + 1 < argc) query.intersection = atoll(argv[++i]);
+        else if (arg == "--full-scan") query.fullScan = true;
+        else if (arg == "--class" && i + 1 < argc) {
+            VehicleClass type = parseVehicleClass(argv[++i]);
+            if (type == INVALID_VEHICLE) {
+                cout << "Unknown vehicle class " << argv[i] << endl;
+                return 1;
+            }
+            query.vehicleClass = type;
+        } else {
+            cout << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    auto startTime = chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path, false)) {
+        cout << "Error: Unable to open " << path << endl;
+        return 1;
+    }
+    PassLogFileHeader header;
+    memset(&header, 0, sizeof(header));
+    if (file.Size() >= sizeof(header)) memcpy(&header, file.Data(), sizeof(header));
+    if (memcmp(header.magic, passLogMagic, sizeof(header.magic)) != 0) {
+        cout << "Error: " << path << " is not a passed-vehicle log" << endl;
+        return 1;
+    }
+    if (header.version != passLogVersion) {
+        cout << "Error: " << path << " is log version " << header.version << ", expected " << passLogVersion << endl;
+        return 1;
+    }
+    PassQueryResult result;
+    queryPassLog(file.Data(), file.Size(), query, result);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+
+    cout << "Pass log " << path << ": " << file.Size() << " bytes, " << result.blocks << " blocks" << endl;
+    cout << "Filter: time " << query.from << " to ";
+    if (query.to == UINT64_MAX) cout << "end";
+    else cout << query.to;
+    cout << ", class " << (query.vehicleClass >= 0 ? laneTypes[query.vehicleClass] : "any") << ", intersection ";
+    if (query.intersection >= 0) cout << query.intersection;
+    else cout << "any";
+    cout << endl;
+    cout << "Vehicles: " << result.matched << endl;
+    if (result.matched > 0) {
+        double sum = 0;
+        for (size_t wait = 0; wait < result.waitCounts.size(); wait++) sum += (double)wait * result.waitCounts[wait];
+        cout << "Wait (s): mean " << sum / result.matched << "  p50 " << waitPercentile(result.waitCounts, result.matched, 0.5)
+             << "  p90 " << waitPercentile(result.waitCounts, result.matched, 0.9)
+             << "  p99 " << waitPercentile(result.waitCounts, result.matched, 0.99)
+             << "  max " << waitPercentile(result.waitCounts, result.matched, 1.0) << endl;
+    }
+    cout << "Blocks: " << result.skipped << " skipped, " << result.headerOnly << " answered from headers, "
+         << result.decoded << " decoded (" << result.decodedBytes << " column bytes read)" << endl;
+    cout << "Query time: " << ms << " ms" << endl;
+    if (!result.problem.empty()) {
+        cout << "WARNING: stopped early, " << result.problem << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Seals the snapshot and writes it next to path first, then renames it over path,
+// so a crash mid-write leaves the previous snapshot intact
+bool writeSnapshotFile(const string& path, vector<char>& buffer) {
+    SnapshotWriter::seal(buffer);
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary, ios::binary | ios::trunc);
+        if (!file.is_open()) return false;
+        file.write(buffer.data(), buffer.size());
+        if (!file) return false;
+    }
+#if defined(_WIN32)
+    remove(path.c_str()); // rename() does not replace an existing file on Windows
+#endif
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+// Writes periodic snapshots from a background thread. The simulation only pays
+// for copying its state into a buffer; submit() swaps that buffer with the idle
+// one and returns at once. If the previous snapshot is still being written the
+// new one is dropped (and counted) rather than making the simulation wait.
+class BackgroundSnapshotter {
+    string path;
+    vector<char> pending;
+    bool hasPending;
+    bool stopping;
+    mutex lock;
+    condition_variable wakeUp;
+    thread writer;
+
+    void writeLoop() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wakeUp.wait(guard, [this] { return hasPending || stopping; });
+            if (!hasPending) return;
+            guard.unlock();
+            auto startTime = chrono::steady_clock::now();
+            bool ok = writeSnapshotFile(path, pending);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+            guard.lock();
+            if (ok) written++;
+            else failed++;
+            lastWriteMs = ms;
+            hasPending = false;
+        }
+    }
+
+public:
+    long long written, skipped, failed;
+    double lastWriteMs;
+
+    BackgroundSnapshotter(const string& path) {
+        this->path = path;
+        hasPending = stopping = false;
+        written = skipped = failed = 0;
+        lastWriteMs = 0;
+        writer = thread(&BackgroundSnapshotter::writeLoop, this);
+    }
+
+    // Takes the captured snapshot (buffer gets the old one back for reuse)
+    bool submit(vector<char>& buffer) {
+        {
+            lock_guard<mutex> guard(lock);
+            if (hasPending) {
+                skipped++;
+                return false;
+            }
+            pending.swap(buffer);
+            hasPending = true;
+        }
+        wakeUp.notify_one();
+        return true;
+    }
+
+    // Waits for the snapshot in flight, if any, and stops the writer thread
+    void finish() {
+        {
+            lock_guard<mutex> guard(lock);
+            if (stopping) return;
+            stopping = true;
+        }
+        wakeUp.notify_one();
+        if (writer.joinable()) writer.join();
+    }
+
+    ~BackgroundSnapshotter() {
+        finish();
+    }
+};
+
+// Reusable rendezvous for the grid workers: every thread blocks in
+// arriveAndWait() until all of them have reached it.
+class TickBarrier {
+    mutex lock;
+    condition_variable allArrived;
+    int threads;
+    int waiting;
+    unsigned long long generation;
+
+public:
+    TickBarrier(int threads) {
+        this->threads = threads;
+        waiting = 0;
+        generation = 0;
+    }
+
+    void arriveAndWait() {
+        unique_lock<mutex> guard(lock);
+        unsigned long long myGeneration = generation;
+        if (++waiting == threads) {
+            waiting = 0;
+            generation++;
+            allArrived.notify_all();
+            return;
+        }
+        allArrived.wait(guard, [&] { return generation != myGeneration; });
+    }
+};
+
+// minstd_rand with its state in the open, so a snapshot can save and resume it
+struct SpawnRandom {
+    uint32_t state;
+
+    SpawnRandom(uint64_t seed = 1) {
+        state = (uint32_t)(seed % 2147483647u);
+        if (state == 0) state = 1;
+    }
+
+    uint32_t operator()() {
+        state = (uint32_t)((uint64_t)state * 48271u % 2147483647u);
+        return state;
+    }
+};
+
+// A width x height grid of intersections, each one a Road. Trucks and bikes that
+// get through a green signal drive on to the intersection to the east, cars to
+// the one to the south, and anything leaving the edge of the grid leaves the city.
+// Signals live in a SignalBank (three per intersection, lane order) rather than
+// in each Road. A tick is one simulated second and runs in two phases, each
+// split across the threads:
+//   1. every intersection moves up to releasePerTick vehicles per green lane
+//      into its outboxes and spawns new arrivals;
+//   2. every intersection pulls the outboxes of its west and then its north
+//      neighbour, so the final state does not depend on the thread count, and
+//      each thread advances its share of the signal bank for the next tick.
+template <class Lane>
+class CityGrid {
+public:
+    int width, height;
+    Road<Lane>* roads;
+    SignalBank signals;
+    vector<vector<Vehicles>> eastOutbox;
+    vector<vector<Vehicles>> southOutbox;
+    vector<SpawnRandom> spawners;   // one per intersection keeps arrivals deterministic
+    vector<long long> spawned;
+    vector<long long> exited;
+    vector<long long> handedOff;
+    int releasePerTick;
+    int spawnPercent;
+
+    // Periodic snapshots, see setPeriodicSnapshots()
+    BackgroundSnapshotter* snapshotter;
+    int snapshotEvery;
+    vector<char> captureBuffer;
+    long long captures;
+    double captureMs;
+
+    // One RoadMetrics per worker thread, so no two threads update the same counters
+    deque<RoadMetrics> threadMetrics;
+    // Likewise one pass-log writer per worker thread, see enablePassLog()
+    deque<PassLogWriter> threadPassLogs;
+
+    // An empty grid, for restore()
+    CityGrid() {
+        width = height = 0;
+        roads = nullptr;
+        releasePerTick = 2;
+        spawnPercent = 0;
+        clearSnapshotSettings();
+    }
+
+    void clearSnapshotSettings() {
+        snapshotter = nullptr;
+        snapshotEvery = 0;
+        captures = 0;
+        captureMs = 0;
+    }
+
+    CityGrid(int width, int height, int vehiclesPerIntersection, int spawnPercent, unsigned seed) {
+        this->width = width;
+        this->height = height;
+        this->spawnPercent = spawnPercent;
+        releasePerTick = 2;
+        clearSnapshotSettings();
+        allocate(width * height);
+        for (int i = 0; i < width * height; i++) {
+            spawners.push_back(SpawnRandom(seed + i));
+            for (int lane = 0; lane < 3; lane++) signals.add(10, 15, 5, i % 30); // staggered cycles
+            for (int v = 0; v < vehiclesPerIntersection; v++) spawnVehicle(i);
+        }
+        signals.advance(1); // signals always run one second ahead of the tick being simulated
+    }
+
+    void allocate(int count) {
+        roads = new Road<Lane>[count];
+        for (int i = 0; i < count; i++) roads[i].intersection = (uint32_t)i;
+        eastOutbox.resize(count);
+        southOutbox.resize(count);
+        spawned.assign(count, 0);
+        exited.assign(count, 0);
+        handedOff.assign(count, 0);
+    }
+
+    // Copies the whole grid into buffer. Only valid between ticks, when the outboxes are empty.
+    void capture(vector<char>& buffer) {
+        SnapshotWriter out(buffer, GRID_SNAPSHOT);
+        out.put((int32_t)Lane::InputMode);
+        out.put((int32_t)width);
+        out.put((int32_t)height);
+        out.put((int32_t)releasePerTick);
+        out.put((int32_t)spawnPercent);
+        plateRegistry.save(out);
+        signals.save(out);
+        for (int i = 0; i < Intersections(); i++) {
+            out.put(spawners[i].state);
+            out.put((int64_t)spawned[i]);
+            out.put((int64_t)exited[i]);
+            out.put((int64_t)handedOff[i]);
+            roads[i].saveLanes(out);
+        }
+    }
+
+    // Loads a grid saved by capture() (with any lane type) into an empty grid
+    bool restore(SnapshotReader& in) {
+        if (roads != nullptr || in.kind != GRID_SNAPSHOT) return false;
+        in.get<int32_t>(); // lane type it was saved from
+        width = in.get<int32_t>();
+        height = in.get<int32_t>();
+        releasePerTick = in.get<int32_t>();
+        spawnPercent = in.get<int32_t>();
+        if (!in.ok() || width <= 0 || height <= 0 || (long long)width * height > 1LL << 30) return false;
+        if (!plateRegistry.load(in) || !signals.load(in) || signals.Size() != width * height * 3) return false;
+        allocate(width * height);
+        spawners.resize(width * height);
+        for (int i = 0; i < Intersections(); i++) {
+            spawners[i].state = in.get<uint32_t>();
+            spawned[i] = in.get<int64_t>();
+            exited[i] = in.get<int64_t>();
+            handedOff[i] = in.get<int64_t>();
+            if (!roads[i].loadLanes(in)) return false;
+        }
+        return in.AtEnd();
+    }
+
+    // While run() is going, capture the grid every `every` ticks and hand it to snapshotter
+    void setPeriodicSnapshots(BackgroundSnapshotter* snapshotter, int every) {
+        this->snapshotter = every > 0 ? snapshotter : nullptr;
+        snapshotEvery = every;
+    }
+
+    // Turns on per-lane metrics for runs with up to threads threads; returns the counters to report
+    vector<RoadMetrics*> enableMetrics(int threads) {
+        while ((int)threadMetrics.size() < threads) threadMetrics.emplace_back();
+        vector<RoadMetrics*> sources;
+        for (RoadMetrics& metrics : threadMetrics) sources.push_back(&metrics);
+        return sources;
+    }
+
+    // Records every vehicle released at a signal into file, for runs with up to threads threads
+    void enablePassLog(PassLogFile* file, int threads) {
+        threadPassLogs.clear();
+        for (int t = 0; t < threads; t++) threadPassLogs.emplace_back(file);
+    }
+
+    // Writes out the partly filled blocks; call once run() has returned
+    void disablePassLog() {
+        for (int i = 0; i < Intersections(); i++) roads[i].attachPassLog(nullptr);
+        threadPassLogs.clear();
+    }
+
+    void takePeriodicSnapshot() {
+        auto startTime = chrono::steady_clock::now();
+        capture(captureBuffer);
+        snapshotter->submit(captureBuffer);
+        captureMs += chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        captures++;
+    }
+
+    ~CityGrid() {
+        delete[] roads;
+    }
+
+    int Intersections() {
+        return width * height;
+    }
+
+    void spawnVehicle(int i) {
+        int lane = spawners[i]() % 3;
+        uint64_t id = ((uint64_t)i << 32) | (uint64_t)spawned[i]++;
+        roads[i].AddVehiclesToLane(Vehicles(id, (VehicleClass)lane));
+    }
+
+    void tickRange(int begin, int end) {
+        Vehicles vehicle;
+        for (int i = begin; i < end; i++) {
+            Road<Lane>& road = roads[i];
+            road.clock++;
+            int x = i % width;
+            int y = i / width;
+            for (int lane = 0; lane < 3; lane++) {
+                if (!signals.isGreen(i * 3 + lane)) continue;
+                bool east = (lane != 1);
+                bool leavesCity = east ? (x == width - 1) : (y == height - 1);
+                for (int r = 0; r < releasePerTick && road.TakeVehicle((VehicleClass)lane, vehicle); r++) {
+                    if (leavesCity) exited[i]++;
+                    else if (east) eastOutbox[i].push_back(vehicle);
+                    else southOutbox[i].push_back(vehicle);
+                }
+                if (road.metrics != nullptr && signals.Remaining(i * 3 + lane) == 1) road.noteGreenEnds((VehicleClass)lane, 1);
+            }
+            if ((int)(spawners[i]() % 100) < spawnPercent) spawnVehicle(i);
+        }
+    }
+
+    void handOffRange(int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            int x = i % width;
+            int y = i / width;
+            if (x > 0) {
+                vector<Vehicles>& inbound = eastOutbox[i - 1];
+                for (Vehicles& vehicle : inbound) roads[i].AddVehiclesToLane(vehicle);
+                handedOff[i] += inbound.size();
+                inbound.clear();
+            }
+            if (y > 0) {
+                vector<Vehicles>& inbound = southOutbox[i - width];
+                for (Vehicles& vehicle : inbound) roads[i].AddVehiclesToLane(vehicle);
+                handedOff[i] += inbound.size();
+                inbound.clear();
+            }
+        }
+    }
+
+    // Merges the tallies of roads [begin, end) into metrics and publishes it; only
+    // the worker thread that owns those roads may call it
+    void publishMetrics(int begin, int end, RoadMetrics* metrics) {
+        for (int i = begin; i < end; i++) roads[i].mergeMetrics();
+        metrics->publish();
+    }
+
+    void run(int ticks, int threads) {
+        int count = Intersections();
+        if (threads > count) threads = count;
+        if (threads < 1) threads = 1;
+        TickBarrier barrier(threads);
+        int blocks = signals.Blocks();
+        // Detached here, while no worker runs, since a road may move to another thread's metrics
+        if (!threadMetrics.empty()) {
+            for (int i = 0; i < count; i++) roads[i].attachMetrics(nullptr);
+        }
+        auto worker = [&](int t) {
+            int begin = (int)((long long)count * t / threads);
+            int end = (int)((long long)count * (t + 1) / threads);
+            int firstBlock = (int)((long long)blocks * t / threads);
+            int lastBlock = (int)((long long)blocks * (t + 1) / threads);
+            RoadMetrics* metrics = threadMetrics.empty() ? nullptr : &threadMetrics[t % threadMetrics.size()];
+            PassLogWriter* passLog = threadPassLogs.empty() ? nullptr : &threadPassLogs[t % threadPassLogs.size()];
+            for (int i = begin; i < end; i++) {
+                roads[i].attachMetrics(metrics);
+                roads[i].attachPassLog(passLog);
+            }
+            for (int tick = 0; tick < ticks; tick++) {
+                tickRange(begin, end);
+                if (metrics != nullptr && metrics->wanted.load(memory_order_relaxed)) publishMetrics(begin, end, metrics);
+                barrier.arriveAndWait();
+                handOffRange(begin, end);
+                signals.advanceBlocks(1, firstBlock, lastBlock);
+                barrier.arriveAndWait();
+                if (snapshotter != nullptr && (tick + 1) % snapshotEvery == 0) {
+                    // the grid is consistent here; hold the others only while thread 0 copies it
+                    if (t == 0) takePeriodicSnapshot();
+                    barrier.arriveAndWait();
+                }
+            }
+            if (metrics != nullptr) publishMetrics(begin, end, metrics);
+        };
+        vector<thread> workers;
+        for (int t = 1; t < threads; t++) workers.push_back(thread(worker, t));
+        worker(0);
+        for (thread& w : workers) w.join();
+    }
+
+    long long Total(const vector<long long>& values) {
+        long long total = 0;
+        for (long long value : values) total += value;
+        return total;
+    }
+
+    long long Queued() {
+        long long total = 0;
+        for (int i = 0; i < Intersections(); i++) {
+            for (int lane = 0; lane < 3; lane++) total += roads[i].LaneSize((VehicleClass)lane);
+        }
+        return total;
+    }
+
+    // FNV-1a over every lane depth and exit count; equal across thread counts
+    unsigned long long Checksum() {
+        unsigned long long hash = 1469598103934665603ULL;
+        auto mix = [&](long long value) {
+            hash ^= (unsigned long long)value;
+            hash *= 1099511628211ULL;
+        };
+        for (int i = 0; i < Intersections(); i++) {
+            for (int lane = 0; lane < 3; lane++) mix(roads[i].LaneSize((VehicleClass)lane));
+            mix(exited[i]);
+        }
+        return hash;
+    }
+};
+
+// Runs the same city once per thread count; returns whether every run ended in the same state
+template <class Lane>
+bool measureGridScaling(int width, int height, int ticks, int vehicles, int spawnPercent, unsigned seed,
+                        const vector<int>& threadCounts) {
+    double baseMs = 0;
+    unsigned long long firstChecksum = 0;
+    bool deterministic = true;
+    for (size_t k = 0; k < threadCounts.size(); k++) {
+        CityGrid<Lane> grid(width, height, vehicles, spawnPercent, seed);
+        auto startTime = chrono::steady_clock::now();
+        grid.run(ticks, threadCounts[k]);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        unsigned long long checksum = grid.Checksum();
+        if (k == 0) {
+            baseMs = ms;
+            firstChecksum = checksum;
+        } else if (checksum != firstChecksum) {
+            deterministic = false;
+        }
+        double speedup = ms > 0 ? baseMs / ms : 0;
+        cout << threadCounts[k] << "        " << ms << "    " << speedup << "x    "
+             << 100.0 * speedup / threadCounts[k] << "%    " << grid.Total(grid.exited) << "    "
+             << grid.Queued() << "    " << hex << checksum << dec << endl;
+    }
+    return deterministic;
+}
+
+// Options for a single grid run (as opposed to the thread scaling table)
+struct GridRunOptions {
+    string snapshotFile;   // final state is saved here, and periodic snapshots too
+    int snapshotEvery = 0;
+    string metricsFile;    // per-lane metrics JSON, rewritten every metricsMs
+    int metricsMs = 1000;
+    string passLogFile;    // columnar log of every vehicle released at a signal
+};
+
+// Runs the grid once with the optional background snapshots and metrics
+template <class Lane>
+int runGridOnce(CityGrid<Lane>& grid, int ticks, int threads, const GridRunOptions& options) {
+    cout << "City grid: " << grid.width << " x " << grid.height << " intersections, " << ticks << " ticks, "
+         << Lane::Name() << " lanes, " << threads << " thread(s)" << endl;
+    double ms = 0;
+    if (ticks > 0) {
+        // Only start the writer thread when there is somewhere to write
+        unique_ptr<BackgroundSnapshotter> snapshotter;
+        if (!options.snapshotFile.empty()) {
+            snapshotter.reset(new BackgroundSnapshotter(options.snapshotFile));
+            grid.setPeriodicSnapshots(snapshotter.get(), options.snapshotEvery);
+        }
+        vector<RoadMetrics*> metrics;
+        if (!options.metricsFile.empty()) metrics = grid.enableMetrics(threads);
+        MetricsReporter reporter(metrics, options.metricsFile, options.metricsMs);
+        PassLogFile passLogFile;
+        if (!options.passLogFile.empty()) {
+            if (!passLogFile.open(options.passLogFile)) return 1;
+            grid.enablePassLog(&passLogFile, threads);
+        }
+        auto startTime = chrono::steady_clock::now();
+        grid.run(ticks, threads);
+        ms = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        if (!options.passLogFile.empty()) {
+            grid.disablePassLog();
+            printPassLogSummary(passLogFile, options.passLogFile);
+        }
+        if (snapshotter) {
+            snapshotter->finish();
+            grid.setPeriodicSnapshots(nullptr, 0);
+            if (grid.captures > 0) {
+                cout << "Periodic snapshots: " << grid.captures << " captured (" << grid.captureMs / grid.captures
+                     << " ms each on the simulation thread), " << snapshotter->written << " written, "
+                     << snapshotter->skipped << " skipped while a write was in flight, last write "
+                     << snapshotter->lastWriteMs << " ms" << endl;
+            }
+            if (snapshotter->failed > 0) cout << "WARNING: " << snapshotter->failed << " snapshot writes failed" << endl;
+        }
+        if (!metrics.empty()) {
+            reporter.finish();
+            reporter.printTable();
+            reporter.printSummary();
+        }
+    }
+    cout << "Run time: " << ms << " ms, exited " << grid.Total(grid.exited) << ", queued " << grid.Queued()
+         << ", checksum " << hex << grid.Checksum() << dec << endl;
+    if (options.snapshotFile.empty()) return 0;
+
+    auto saveStart = chrono::steady_clock::now();
+    vector<char> buffer;
+    grid.capture(buffer);
+    if (!writeSnapshotFile(options.snapshotFile, buffer)) {
+        cout << "Error: could not write snapshot " << options.snapshotFile << endl;
+        return 1;
+    }
+    double saveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - saveStart).count();
+    cout << "Saved " << options.snapshotFile << " (" << buffer.size() << " bytes) in " << saveMs << " ms" << endl;
+    return 0;
+}
+
+template <class Lane>
+int restoreGrid(SnapshotReader& in, int ticks, int threads, const GridRunOptions& options,
+                chrono::steady_clock::time_point openedAt) {
+    CityGrid<Lane> grid;
+    if (!grid.restore(in)) {
+        cout << "Error: snapshot does not hold a valid grid." << endl;
+        return 1;
+    }
+    double restoreMs = chrono::duration<double, milli>(chrono::steady_clock::now() - openedAt).count();
+    cout << "Restored " << grid.width << " x " << grid.height << " grid (" << grid.Queued()
+         << " queued vehicles) in " << restoreMs << " ms" << endl;
+    return runGridOnce(grid, ticks, threads, options);
+}
+
+// Warm restart: continue a grid from a snapshot instead of rebuilding it
+int runGridRestore(int argc, char* argv[]) {
+    if (argc < 3) {
+        cout << "Usage: Traffic_Management --restore <snapshot> [ticks] [--threads N] [--mode list|array]" << endl;
+        cout << "                             [--snapshot <file> [--snapshot-every <ticks>]] [--metrics <file.json> [--metrics-ms N]]" << endl;
+        cout << "                             [--pass-log <file>]" << endl;
+        return 1;
+    }
+    string restoreFile = argv[2];
+    GridRunOptions options; // snapshots only with --snapshot, so the file being restored is never overwritten
+    int ticks = 0, threads = (int)thread::hardware_concurrency(), mode = 0;
+    int i = 3;
+    if (i < argc && argv[i][0] != '-') ticks = atoi(argv[i++]);
+    for (; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (arg == "--mode" && i + 1 < argc) mode = (string(argv[++i]) == "array") ? 2 : 1;
+        else if (arg == "--snapshot" && i + 1 < argc) options.snapshotFile = argv[++i];
+        else if (arg == "--snapshot-every" && i + 1 < argc) options.snapshotEvery = atoi(argv[++i]);
+        else if (arg == "--metrics" && i + 1 < argc) options.metricsFile = argv[++i];
+        else if (arg == "--metrics-ms" && i + 1 < argc) options.metricsMs = atoi(argv[++i]);
+        else if (arg == "--pass-log" && i + 1 < argc) options.passLogFile = argv[++i];
+        else {
+            cout << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    quietMode = true;
 
-    Vehicles(){
-        id = "";
-        type = "";
+    auto openedAt = chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(restoreFile)) {
+        cout << "Error: Unable to open " << restoreFile << endl;
+        return 1;
+    }
+    SnapshotReader in(file.Data(), file.Size());
+    string problem = in.open();
+    if (problem.empty() && in.kind != GRID_SNAPSHOT) problem = "not a grid snapshot";
+    if (!problem.empty()) {
+        cout << "Error: " << restoreFile << ": " << problem << endl;
+        return 1;
     }
+    SnapshotReader peek = in;
+    if (mode == 0) mode = peek.get<int32_t>(); // default to the lane type it was saved from
+    if (mode == 2) return restoreGrid<ArrayQue>(in, ticks, threads, options, openedAt);
+    return restoreGrid<ListQue>(in, ticks, threads, options, openedAt);
+}
 
-    Vehicles(string id, string type){
-        this->id = id;
-        this->type = type;
+int runGrid(int argc, char* argv[]) {
+    if (argc < 5) {
+        cout << "Usage: Traffic_Management --grid <width> <height> <ticks> [--threads N] [--mode list|array]" << endl;
+        cout << "                             [--vehicles <per intersection>] [--spawn <percent per tick>] [--seed N]" << endl;
+        cout << "                             [--snapshot <file> [--snapshot-every <ticks>]] [--metrics <file.json> [--metrics-ms N]]" << endl;
+        cout << "                             [--pass-log <file>]" << endl;
+        return 1;
+    }
+    int width = atoi(argv[2]);
+    int height = atoi(argv[3]);
+    int ticks = atoi(argv[4]);
+    int maxThreads = (int)thread::hardware_concurrency();
+    int mode = 1, vehicles = 20, spawnPercent = 30;
+    unsigned seed = 42;
+    GridRunOptions options;
+    for (int i = 5; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) maxThreads = atoi(argv[++i]);
+        else if (arg == "--snapshot" && i + 1 < argc) options.snapshotFile = argv[++i];
+        else if (arg == "--snapshot-every" && i + 1 < argc) options.snapshotEvery = atoi(argv[++i]);
+        else if (arg == "--metrics" && i + 1 < argc) options.metricsFile = argv[++i];
+        else if (arg == "--metrics-ms" && i + 1 < argc) options.metricsMs = atoi(argv[++i]);
+        else if (arg == "--pass-log" && i + 1 < argc) options.passLogFile = argv[++i];
+        else if (arg == "--mode" && i + 1 < argc) mode = (string(argv[++i]) == "array") ? 2 : 1;
+        else if (arg == "--vehicles" && i + 1 < argc) vehicles = atoi(argv[++i]);
+        else if (arg == "--spawn" && i + 1 < argc) spawnPercent = atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = (unsigned)atol(argv[++i]);
+        else {
+            cout << "Unknown option " << arg << endl;
+            return 1;
+        }
     }
+    if (width <= 0 || height <= 0 || ticks <= 0) {
+        cout << "Width, height and ticks must be positive." << endl;
+        return 1;
+    }
+    if (maxThreads < 1) maxThreads = 1;
+    quietMode = true;
 
-    void displayInfo(){
-        cout<<" <-- ID: "<<id;
-        // cout<<" Type: "<<type;
-        // cout << "Number: ";
-        // cout << "Number: ";
+    if (!options.snapshotFile.empty() || !options.metricsFile.empty() || !options.passLogFile.empty()) {
+        // one run at the full thread count instead of the scaling table
+        if (mode == 2) {
+            CityGrid<ArrayQue> grid(width, height, vehicles, spawnPercent, seed);
+            return runGridOnce(grid, ticks, maxThreads, options);
+        }
+        CityGrid<ListQue> grid(width, height, vehicles, spawnPercent, seed);
+        return runGridOnce(grid, ticks, maxThreads, options);
     }
-    
-};
 
-class Node{
-    public:
-    Vehicles data;
-    Node* next;
+    vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
 
-    Node(){
-        data = Vehicles();
-        next = nullptr;
+    cout << "City grid: " << width << " x " << height << " intersections, " << ticks << " ticks, "
+         << (mode == 1 ? ListQue::Name() : ArrayQue::Name()) << " lanes" << endl;
+    cout << "Threads  Time (ms)  Speedup  Efficiency  Exited    Queued    Checksum" << endl;
+    bool deterministic = mode == 2
+        ? measureGridScaling<ArrayQue>(width, height, ticks, vehicles, spawnPercent, seed, threadCounts)
+        : measureGridScaling<ListQue>(width, height, ticks, vehicles, spawnPercent, seed, threadCounts);
+    cout << (deterministic ? "Final state identical for every thread count." : "WARNING: final state differs between thread counts!") << endl;
+    return deterministic ? 0 : 1;
+}
+
+// Same signals, two layouts: one TrafficSignal object per lane versus a SignalBank
+int runSignalBenchmark(int argc, char* argv[]) {
+    int count = argc > 2 ? atoi(argv[2]) : 100000;
+    int steps = argc > 3 ? atoi(argv[3]) : 1000;
+    if (count <= 0 || steps <= 0) {
+        cout << "Usage: Traffic_Management --bench-signals [signals] [steps]" << endl;
+        return 1;
+    }
+    vector<TrafficSignal> objects;
+    SignalBank bank;
+    for (int i = 0; i < count; i++) {
+        objects.push_back(TrafficSignal(10, 15, 5));
+        objects.back().changeSignal(i % 30);
+        bank.add(10, 15, 5, i % 30);
     }
 
-    Node(Vehicles data){
-        this->data = data;
-        next = nullptr;
+    long long greenObjects = 0;
+    auto startTime = chrono::steady_clock::now();
+    for (int step = 0; step < steps; step++) {
+        for (TrafficSignal& signal : objects) {
+            signal.changeSignal(1);
+            greenObjects += signal.canPass();
+        }
     }
+    double objectNs = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+
+    long long greenBank = 0;
+    startTime = chrono::steady_clock::now();
+    for (int step = 0; step < steps; step++) {
+        bank.advance(1);
+        for (uint64_t word : bank.GreenMask()) greenBank += __builtin_popcountll(word);
+    }
+    double bankNs = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+
+    startTime = chrono::steady_clock::now();
+    bank.advance(86400LL * 365);
+    double yearNs = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+
+    double updates = (double)count * steps;
+    cout << "Signal update benchmark: " << count << " signals x " << steps << " one-second steps" << endl;
+    cout << "TrafficSignal objects: " << objectNs / updates << " ns/signal" << endl;
+    cout << "SignalBank:            " << bankNs / updates << " ns/signal (" << objectNs / bankNs << "x faster)" << endl;
+    cout << "SignalBank one-year jump: " << yearNs / count << " ns/signal" << endl;
+    cout << (greenObjects == greenBank ? "Green counts match." : "WARNING: green counts differ!") << endl;
+    return greenObjects == greenBank ? 0 : 1;
+}
+
+enum SimEventKind { EVENT_ARRIVAL, EVENT_GREEN, EVENT_DEPARTURE };
+
+struct SimEvent {
+    long long time;
+    int kind;
+    int lane;
 };
 
-class ListQue{
-    Node* front;
-    Node* rear;
+// Hierarchical timer wheel with one-second resolution: four levels of 64 slots
+// cover 2^24 seconds (about 194 days) ahead of the current time, anything later
+// waits in an overflow list. An event sits on the level of the highest 6-bit
+// digit in which its time differs from now, and falls to a lower level when
+// now reaches its slot. Each level keeps a bitmask of non-empty slots, so
+// empty stretches of time are skipped with a count-trailing-zeros instead of
+// being stepped through second by second.
+class TimerWheel {
+    static const int levels = 4;
+    static const int slotBits = 6;
+    vector<SimEvent> slots[levels][64];
+    uint64_t occupied[levels];
+    vector<SimEvent> overflow;
+    long long now;
+    long long pending;
 
-    public:
-    ListQue(){
-        front = nullptr;
-        rear = nullptr;
+    void place(const SimEvent& event) {
+        long long time = event.time < now ? now : event.time;
+        unsigned long long difference = (unsigned long long)(time ^ now);
+        for (int level = 0; level < levels; level++) {
+            int shift = slotBits * level;
+            if (difference >> (shift + slotBits) == 0) {
+                int slot = (int)((time >> shift) & 63);
+                slots[level][slot].push_back(event);
+                slots[level][slot].back().time = time;
+                occupied[level] |= 1ULL << slot;
+                return;
+            }
+        }
+        overflow.push_back(event);
     }
 
-    void Enqueue(Vehicles data){
-        Node* newNode = new Node(data);
+public:
+    TimerWheel() {
+        for (int level = 0; level < levels; level++) occupied[level] = 0;
+        now = 0;
+        pending = 0;
+    }
 
-        if (front == nullptr){
-            front = rear = newNode;
-        }
-        else{
-            rear->next = newNode;
-            rear = newNode;
-        }
-    } 
+    long long Now() {
+        return now;
+    }
 
-    void Dequeue() {
-        if (front == nullptr) {
-            cout << "The queue is empty" << endl;
-            return;
-        }
-        Node* temp = front;
-        ofstream file("passed_vehicles.txt", ios::app);
-        if (file.is_open()) {
-            file << temp->data.id << endl; // Log the ID of the removed vehicle
-            file.close();
-        } else {
-            cout << "Error: Unable to open the file for logging vehicle IDs." << endl;
+    long long Pending() {
+        return pending;
+    }
+
+    void schedule(const SimEvent& event) {
+        pending++;
+        place(event);
+    }
+
+    // Moves now to the earliest pending time and hands back every event due then.
+    // Events scheduled for that same time while handling them come out on the next call.
+    bool popDue(vector<SimEvent>& due) {
+        due.clear();
+        while (pending > 0) {
+            int current = (int)(now & 63);
+            uint64_t ahead = occupied[0] & (~0ULL << current);
+            if (ahead != 0) {
+                int slot = __builtin_ctzll(ahead);
+                now = (now & ~63LL) | slot;
+                due.swap(slots[0][slot]);
+                occupied[0] &= ~(1ULL << slot);
+                pending -= due.size();
+                return true;
+            }
+            bool cascaded = false;
+            for (int level = 1; level < levels && !cascaded; level++) {
+                int shift = slotBits * level;
+                int digit = (int)((now >> shift) & 63);
+                uint64_t later = digit == 63 ? 0 : occupied[level] & (~0ULL << (digit + 1));
+                if (later == 0) continue;
+                int slot = __builtin_ctzll(later);
+                // jump to the start of that slot and spread its events over the lower levels
+                long long block = now >> (shift + slotBits) << (shift + slotBits);
+                now = block | ((long long)slot << shift);
+                vector<SimEvent> moving;
+                moving.swap(slots[level][slot]);
+                occupied[level] &= ~(1ULL << slot);
+                for (const SimEvent& event : moving) place(event);
+                cascaded = true;
+            }
+            if (cascaded) continue;
+            // everything left is more than 2^24 seconds away
+            long long earliest = overflow[0].time;
+            for (const SimEvent& event : overflow) earliest = min(earliest, event.time);
+            now = earliest;
+            vector<SimEvent> moving;
+            moving.swap(overflow);
+            for (const SimEvent& event : moving) place(event);
         }
+        return false;
+    }
+};
 
-        cout << "Removing Vehicle ID: " << temp->data.id << " from the lane." << endl; // Added message
-        front = front->next;
-        delete temp;
-        if (front == nullptr) { // Reset rear if queue is empty after dequeue
-            rear = nullptr;
+struct TimedArrival {
+    long long time;
+    Vehicles vehicle;
+};
+
+// Event-driven single-intersection simulation. A green lane lets one vehicle
+// through per second. Nothing is polled: a lane only has an event pending
+// while vehicles wait in it (the next departure, or the moment its signal
+// turns green), and a signal is fast-forwarded in closed form when its lane
+// next needs it. Idle lanes and signals cost nothing between arrivals.
+class EventSimulator {
+public:
+    RoadBase& road;
+    TimerWheel wheel;
+    vector<TimedArrival>& arrivals;   // sorted by time
+    size_t nextArrival;
+    long long signalTime[3];          // when each lane's signal was last brought up to date
+    long long laneFreeAt[3];          // one vehicle per second: earliest time of the next release
+    bool lanePending[3];
+    long long passed[3] = {0, 0, 0};
+    long long totalWait[3] = {0, 0, 0};
+    long long eventsHandled;
+
+    EventSimulator(RoadBase& road, vector<TimedArrival>& arrivals) : road(road), arrivals(arrivals) {
+        nextArrival = 0;
+        eventsHandled = 0;
+        for (int lane = 0; lane < 3; lane++) {
+            signalTime[lane] = 0;
+            laneFreeAt[lane] = 0;
+            lanePending[lane] = false;
         }
     }
 
-    void Display(){
-        Node* temp = front;
-        while (temp != nullptr){
-            temp->data.displayInfo();
-            temp = temp->next;
+    TrafficSignal& syncSignal(int lane) {
+        TrafficSignal& signal = road.SignalForLane((VehicleClass)lane);
+        signal.changeSignal(wheel.Now() - signalTime[lane]);
+        signalTime[lane] = wheel.Now();
+        return signal;
+    }
+
+    // Seconds until the signal is next green (0 if it is green now)
+    long long untilGreen(TrafficSignal& signal) {
+        if (signal.phase == GREEN) return 0;
+        if (signal.phase == RED) return signal.duration;
+        return signal.duration + signal.redTime;
+    }
+
+    // Schedules the lane's next release: after the headway if it is still green
+    // then, otherwise at the start of its next green phase
+    void scheduleLane(int lane) {
+        TrafficSignal probe = syncSignal(lane);
+        long long delay = laneFreeAt[lane] > wheel.Now() ? laneFreeAt[lane] - wheel.Now() : 0;
+        probe.changeSignal(delay);
+        long long wait = untilGreen(probe);
+        wheel.schedule({wheel.Now() + delay + wait, wait == 0 ? EVENT_DEPARTURE : EVENT_GREEN, lane});
+        lanePending[lane] = true;
+    }
+
+    void scheduleNextArrival() {
+        if (nextArrival < arrivals.size()) {
+            wheel.schedule({arrivals[nextArrival].time, EVENT_ARRIVAL, -1});
         }
-        cout<<endl;
     }
 
-    void Front(){
-        if (front == nullptr){
-            cout<<"The queue is empty"<<endl;
+    void handle(const SimEvent& event) {
+        eventsHandled++;
+        if (event.kind == EVENT_ARRIVAL) {
+            Vehicles& vehicle = arrivals[nextArrival++].vehicle;
+            road.clock = wheel.Now();
+            if (road.AddVehiclesToLane(vehicle) && !lanePending[vehicle.type]) scheduleLane(vehicle.type);
+            scheduleNextArrival();
             return;
         }
-        front->data.displayInfo();
+        // a green event is the signal change that lets a waiting lane move again
+        int lane = event.lane;
+        lanePending[lane] = false;
+        Vehicles vehicle;
+        if (syncSignal(lane).canPass() && road.DequeueVehiclesFromLanes((VehicleClass)lane, &vehicle)) {
+            passed[lane]++;
+            totalWait[lane] += vehicle.waitedAt(wheel.Now());
+            laneFreeAt[lane] = wheel.Now() + 1;
+        }
+        if (road.LaneSize((VehicleClass)lane) > 0) scheduleLane(lane);
     }
 
-    void Rear(){
-        if (rear == nullptr){
-            cout<<"The queue is empty"<<endl;
-            return;
+    void run() {
+        scheduleNextArrival();
+        vector<SimEvent> due;
+        while (wheel.popDue(due)) {
+            for (const SimEvent& event : due) handle(event);
         }
-        rear->data.displayInfo();
     }
+};
 
-    void IsEmpty(){
-        if (front == nullptr){
-            cout<<"The queue is empty"<<endl;
+// Reference model for the event simulator: step the same road one second at a time
+void runPolledSimulation(RoadBase& road, vector<TimedArrival>& arrivals, long long passed[3], long long totalWait[3]) {
+    size_t next = 0;
+    long long endTime = arrivals.empty() ? 0 : arrivals.back().time;
+    for (long long now = 0; next < arrivals.size() || road.LaneSize(TRUCK) + road.LaneSize(CAR) + road.LaneSize(BIKE) > 0; now++) {
+        if (now > 0) road.updateAllSignals(1);
+        for (; next < arrivals.size() && arrivals[next].time == now; next++) {
+            road.AddVehiclesToLane(arrivals[next].vehicle);
         }
-        else{
-            cout<<"The queue is not empty"<<endl;
+        for (int lane = 0; lane < 3; lane++) {
+            Vehicles vehicle;
+            if (road.DequeueVehiclesFromLanes((VehicleClass)lane, &vehicle)) {
+                passed[lane]++;
+                totalWait[lane] += vehicle.waitedAt(now);
+            }
         }
+        if (now > endTime + 1000000000LL) break; // a lane that never turns green
     }
+}
 
-    void Clear() {
-    while (front != nullptr) {
-        Node* temp = front;
-        front = front->next;
-        delete temp;
+int runEventSimulation(int argc, char* argv[]) {
+    long long count = 100000;
+    double meanGap = 60;
+    unsigned seed = 42;
+    bool compare = false;
+    string arrivalsFile;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--arrivals" && i + 1 < argc) count = atoll(argv[++i]);
+        else if (arg == "--mean-gap" && i + 1 < argc) meanGap = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = (unsigned)atol(argv[++i]);
+        else if (arg == "--file" && i + 1 < argc) arrivalsFile = argv[++i];
+        else if (arg == "--compare") compare = true;
+        else {
+            cout << "Usage: Traffic_Management --events [--arrivals N] [--mean-gap <seconds>] [--seed N] [--compare]" << endl;
+            cout << "       Traffic_Management --events --file <arrivals> [--compare]   (lines: '<time> <id> <type>')" << endl;
+            return 1;
+        }
     }
-    rear = nullptr;  // Reset rear to null after clearing
-}
+    quietMode = true;
 
-    ~ListQue(){
-        Clear();
+    vector<TimedArrival> arrivals;
+    if (!arrivalsFile.empty()) {
+        ifstream file(arrivalsFile);
+        if (!file.is_open()) {
+            cout << "Error: Unable to open arrivals file " << arrivalsFile << endl;
+            return 1;
+        }
+        long long time;
+        string plate, type;
+        while (file >> time >> plate >> type) {
+            Vehicles vehicle(plate, type);
+            if (time >= 0 && vehicle.type != INVALID_VEHICLE) arrivals.push_back({time, vehicle});
+        }
+        stable_sort(arrivals.begin(), arrivals.end(),
+                    [](const TimedArrival& a, const TimedArrival& b) { return a.time < b.time; });
+    } else {
+        mt19937 rng(seed);
+        exponential_distribution<double> gap(meanGap > 0 ? 1.0 / meanGap : 1.0);
+        double clock = 0;
+        for (long long i = 0; i < count; i++) {
+            clock += gap(rng);
+            arrivals.push_back({(long long)clock, Vehicles((uint64_t)(i + 1), (VehicleClass)(rng() % 3))});
+        }
     }
-    
-};
+    long long span = arrivals.empty() ? 0 : arrivals.back().time;
 
-class ArrayQue{
-    public:
-    int rear, front;
-    static const int size = 5;
-    Vehicles arr[size]; 
+    Road<ListQue> road;
+    EventSimulator simulator(road, arrivals);
+    auto startTime = chrono::steady_clock::now();
+    simulator.run();
+    double eventMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
 
-    ArrayQue(){
-        rear = front = -1;
+    cout << "Event-driven simulation: " << arrivals.size() << " arrivals over " << span << " simulated seconds" << endl;
+    cout << "Events handled: " << simulator.eventsHandled << ", runtime " << eventMs << " ms" << endl;
+    cout << "Lane    Passed    Avg wait (s)" << endl;
+    for (int lane = 0; lane < 3; lane++) {
+        cout << laneTypes[lane] << "    " << simulator.passed[lane] << "    "
+             << (simulator.passed[lane] ? (double)simulator.totalWait[lane] / simulator.passed[lane] : 0) << endl;
     }
 
-    bool isFull(){
-        return (rear == size - 1); 
+    if (compare) {
+        Road<ListQue> polledRoad;
+        long long passed[3] = {0, 0, 0}, totalWait[3] = {0, 0, 0};
+        startTime = chrono::steady_clock::now();
+        runPolledSimulation(polledRoad, arrivals, passed, totalWait);
+        double polledMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        bool same = true;
+        for (int lane = 0; lane < 3; lane++) {
+            same = same && passed[lane] == simulator.passed[lane] && totalWait[lane] == simulator.totalWait[lane];
+        }
+        cout << "Polled one-second simulation: " << polledMs << " ms (" << polledMs / eventMs << "x slower)" << endl;
+        cout << (same ? "Both simulations agree on every passed vehicle and wait time." : "WARNING: event and polled simulations differ!") << endl;
+        if (!same) return 1;
     }
+    return 0;
+}
 
-    bool isEmpty(){
-        return front == -1;
+// Bounded multi-producer, single-consumer ring (Vyukov's sequence-numbered cells).
+// A producer claims a slot with one compare-and-swap on tail, fills it and then
+// publishes it by bumping the cell's sequence; the single consumer reads cells in
+// order and never touches tail. Nothing blocks: a full ring makes tryPush return
+// false and an unpublished cell makes tryPop return false.
+class MpscRing {
+    struct Cell {
+        atomic<uint64_t> sequence;
+        Vehicles vehicle;
+    };
+
+    Cell* cells;
+    size_t mask;
+    alignas(64) atomic<uint64_t> tail;  // next slot a producer will claim
+    alignas(64) uint64_t head;          // next slot the consumer reads
+
+public:
+    MpscRing(size_t capacity = 4096) {
+        size_t size = ArrayQue::roundUpToPowerOfTwo(capacity > 1 ? capacity : 2);
+        cells = new Cell[size];
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, memory_order_relaxed);
+        tail.store(0, memory_order_relaxed);
+        head = 0;
     }
 
-    void Enqueue(Vehicles value){
-        if (isFull()){
-            cout<<"The Lane is full, you can't add more vehicles!"<<endl;
-            return;
-        }
-        if (isEmpty()){
-            front = rear = 0;
-            arr[rear] = value;
-            return;
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Safe from any number of threads at once
+    bool tryPush(const Vehicles& vehicle) {
+        uint64_t position = tail.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[position & mask];
+            uint64_t sequence = cell.sequence.load(memory_order_acquire);
+            int64_t lag = (int64_t)(sequence - position);
+            if (lag == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                    cell.vehicle = vehicle;
+                    cell.sequence.store(position + 1, memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false; // the consumer has not freed this cell yet: full
+            } else {
+                position = tail.load(memory_order_relaxed); // another producer got there first
+            }
         }
-        arr[++rear] = value; 
     }
 
-    void Dequeue() {
-    if (isEmpty()) {
-        cout << "The Lane is already Empty!" << endl;
-        return;
+    // Consumer thread only
+    bool tryPop(Vehicles& out) {
+        Cell& cell = cells[head & mask];
+        if (cell.sequence.load(memory_order_acquire) != head + 1) return false;
+        out = cell.vehicle;
+        cell.sequence.store(head + mask + 1, memory_order_release); // free for the next lap
+        head++;
+        return true;
     }
-    ofstream file("passed_vehicles.txt", ios::app);
-        if (file.is_open()) {
-            file << arr[front].id << endl;
-            file.close();
-        } else {
-            cout << "Error: Unable to open the file for logging vehicle IDs." << endl;
-        }
 
-    cout << "Removing Vehicle ID: " << arr[front].id << " from the lane." << endl; // Added message
-    if (front == rear) {
-        front = rear = -1;
-    } else {
-        front++;
+    ~MpscRing() {
+        delete[] cells;
     }
-}
+};
 
-    void Display(){
-        for (int i = front; i <= rear; i++){
-            arr[i].displayInfo();
+// Concurrent front end for one Road. Any number of sensor threads call submit();
+// arrivals go into one MpscRing per lane. A single controller thread owns the
+// road: it moves arrivals from the rings into the lanes, advances the signals one
+// simulated second every secondMicros of wall time, and lets vehicles through
+// whenever a lane's signal is green. Only the controller ever touches the road,
+// so the lanes themselves stay unsynchronized.
+template <class Lane>
+class IngestController {
+    Road<Lane>& road;
+    MpscRing rings[3];
+    atomic<bool> stopping;
+    thread controller;
+    long long secondMicros;
+    int drainBatch;
+
+    // Moves up to drainBatch arrivals per lane into the road; returns how many moved
+    int drainRings() {
+        int moved = 0;
+        Vehicles vehicle;
+        for (int lane = 0; lane < 3; lane++) {
+            for (int k = 0; k < drainBatch && rings[lane].tryPop(vehicle); k++) {
+                road.AddVehiclesToLane(vehicle);
+                ingested[lane]++;
+                moved++;
+            }
         }
+        return moved;
     }
-};
-
-class TrafficSignal{
-    public:
-    string state;
-    int duration;
 
-    TrafficSignal(){
-        state = "Red";
-        duration = 10;
+    void releaseGreenLanes() {
+        for (int lane = 0; lane < 3; lane++) {
+            if (!road.LaneCanPass((VehicleClass)lane)) continue;
+            while (road.DequeueVehiclesFromLanes((VehicleClass)lane)) passed[lane]++;
+        }
     }
 
-    void changeSignal(int elapsedTime) {
-        while (elapsedTime > 0) {
-            if (elapsedTime < duration) {
-                duration -= elapsedTime;
-                break;
+    void controlLoop() {
+        auto nextSecond = chrono::steady_clock::now() + chrono::microseconds(secondMicros);
+        while (true) {
+            bool finishing = stopping.load(memory_order_acquire);
+            int moved = drainRings();
+            auto now = chrono::steady_clock::now();
+            if (now >= nextSecond) {
+                // catch up in one step if the controller fell behind
+                long long seconds = chrono::duration_cast<chrono::microseconds>(now - nextSecond).count() / secondMicros + 1;
+                road.updateAllSignals(seconds);
+                nextSecond += chrono::microseconds(seconds * secondMicros);
             }
-            elapsedTime -= duration;
-            if (state == "Red") {
-                state = "Green";
-                duration = 15;
-            } else if (state == "Green") {
-                state = "Yellow";
-                duration = 5;
-            } else if (state == "Yellow") {
-                state = "Red";
-                duration = 10;
+            releaseGreenLanes();
+            if (moved > 0) {
+                drains++;
+                drained += moved;
+            } else if (finishing) {
+                return; // producers are done and the rings are empty
+            } else {
+                this_thread::yield();
             }
         }
-}
+    }
 
+public:
+    // Controller-side counters; read them after finish()
+    long long ingested[3] = {0, 0, 0};
+    long long passed[3] = {0, 0, 0};
+    long long drains = 0, drained = 0;
 
-    void displaySignal() {
-        cout << "Signal: " << state << " | Remaining Duration: " << duration << " seconds" << endl;
+    IngestController(Road<Lane>& road, size_t ringCapacity = 4096, long long secondMicros = 1000, int drainBatch = 256)
+        : road(road), rings{MpscRing(ringCapacity), MpscRing(ringCapacity), MpscRing(ringCapacity)} {
+        this->secondMicros = secondMicros > 0 ? secondMicros : 1;
+        this->drainBatch = drainBatch > 0 ? drainBatch : 1;
+        stopping.store(false);
+        controller = thread(&IngestController::controlLoop, this);
     }
 
-    bool canPass(){
-        return state == "Green";
+    // Called by producer threads. Spins (yielding) while the lane's ring is full, so a
+    // slow controller pushes back on the sensors; returns how many times it had to wait.
+    long long submit(const Vehicles& vehicle) {
+        if (vehicle.type >= INVALID_VEHICLE) return 0;
+        long long waits = 0;
+        while (!rings[vehicle.type].tryPush(vehicle)) {
+            waits++;
+            this_thread::yield();
+        }
+        return waits;
+    }
+
+    // Call once every producer has stopped: drains what is left and stops the controller
+    void finish() {
+        stopping.store(true, memory_order_release);
+        if (controller.joinable()) controller.join();
+    }
+
+    ~IngestController() {
+        finish();
     }
 };
 
-class Road {
-public:
-    ListQue TruckLane_list;
-    ListQue CarLane_list;
-    ListQue BikeLane_list;
+template <class Lane>
+void runIngestRound(int producers, int milliseconds, size_t ringCapacity) {
+    Road<Lane> road;
+    IngestController<Lane> ingest(road, ringCapacity);
+    atomic<bool> go(false), stop(false);
+    vector<long long> pushed(producers, 0), waited(producers, 0);
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.push_back(thread([&, p] {
+            minstd_rand rng(p + 1);
+            uint64_t id = (uint64_t)(p + 1) << 40; // disjoint ID range per sensor
+            long long count = 0, waits = 0;
+            while (!go.load(memory_order_acquire)) this_thread::yield();
+            while (!stop.load(memory_order_relaxed)) {
+                for (int k = 0; k < 64; k++) waits += ingest.submit(Vehicles(id++, (VehicleClass)(rng() % 3)));
+                count += 64;
+            }
+            pushed[p] = count;
+            waited[p] = waits;
+        }));
+    }
+    auto startTime = chrono::steady_clock::now();
+    go.store(true, memory_order_release);
+    this_thread::sleep_for(chrono::milliseconds(milliseconds));
+    stop.store(true, memory_order_relaxed);
+    for (thread& t : threads) t.join();
+    double producerSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    ingest.finish();
 
-    ArrayQue TruckLane_array;
-    ArrayQue CarLane_array;
-    ArrayQue BikeLane_array;
+    long long totalPushed = 0, totalWaits = 0, ingested = 0, passed = 0, queued = 0;
+    for (int p = 0; p < producers; p++) {
+        totalPushed += pushed[p];
+        totalWaits += waited[p];
+    }
+    for (int lane = 0; lane < 3; lane++) {
+        ingested += ingest.ingested[lane];
+        passed += ingest.passed[lane];
+        queued += road.LaneSize((VehicleClass)lane);
+    }
+    bool consistent = ingested == totalPushed && ingested == passed + queued;
+    cout << producers << "          " << totalPushed << "    " << totalPushed / producerSeconds / 1e6 << "    "
+         << totalWaits << "    " << (ingest.drains > 0 ? ingest.drained / ingest.drains : 0) << "    "
+         << passed << "    " << queued << (consistent ? "" : "    MISMATCH") << endl;
+}
 
-    TrafficSignal TruckSignal;
-    TrafficSignal CarSignal;
-    TrafficSignal BikeSignal;
+// Producer threads hammer one intersection for a fixed time; reports the arrival
+// rate the rings and the controller sustain as the number of producers doubles
+int runIngestBenchmark(int argc, char* argv[]) {
+    int milliseconds = 500, maxProducers = max(2, (int)thread::hardware_concurrency()), mode = 1;
+    size_t ringCapacity = 4096;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--ms" && i + 1 < argc) milliseconds = atoi(argv[++i]);
+        else if (arg == "--producers" && i + 1 < argc) maxProducers = atoi(argv[++i]);
+        else if (arg == "--ring" && i + 1 < argc) ringCapacity = (size_t)atoll(argv[++i]);
+        else if (arg == "--mode" && i + 1 < argc) mode = (string(argv[++i]) == "array") ? 2 : 1;
+        else {
+            cout << "Usage: Traffic_Management --bench-ingest [--ms <per run>] [--producers N] [--ring <slots>] [--mode list|array]" << endl;
+            return 1;
+        }
+    }
+    if (milliseconds <= 0 || maxProducers <= 0) {
+        cout << "--ms and --producers must be positive." << endl;
+        return 1;
+    }
+    quietMode = true;
+    passedLog.setEnabled(false); // measure ingestion, not the log file
+    cout << "Ingestion stress: " << milliseconds << " ms per run, ring of " << ringCapacity << " per lane, "
+         << (mode == 2 ? ArrayQue::Name() : ListQue::Name()) << " lanes, "
+         << thread::hardware_concurrency() << " hardware threads" << endl;
+    cout << "Producers  Arrivals  M arrivals/s  FullWaits  AvgDrain  Passed  Queued" << endl;
+    for (int producers = 1;; producers *= 2) {
+        int count = min(producers, maxProducers);
+        if (mode == 2) runIngestRound<ArrayQue>(count, milliseconds, ringCapacity);
+        else runIngestRound<ListQue>(count, milliseconds, ringCapacity);
+        if (count == maxProducers) break;
+    }
+    return 0;
+}
 
-    int inputMode; // 1 for Linked List, 2 for Array
+// Middle value of a set of timings (the mean of the two middle ones for an even count)
+double medianOf(vector<double> values) {
+    sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
 
-    Road() {
-        inputMode = 0;
+// Runs the same grid and the same batch trace with and without metrics attached,
+// back to back so each pair sees the same machine conditions. The overhead is the
+// median over the pairs, so one disturbed run (or a slow drift) cannot swing it.
+int runMetricsBenchmark(int argc, char* argv[]) {
+    int side = argc > 2 ? atoi(argv[2]) : 60;
+    int ticks = argc > 3 ? atoi(argv[3]) : 200;
+    int repeats = argc > 4 ? atoi(argv[4]) : 9;
+    if (side <= 0 || ticks <= 0 || repeats <= 0) {
+        cout << "Usage: Traffic_Management --bench-metrics [grid side] [ticks] [repeats]" << endl;
+        return 1;
     }
+    quietMode = true;
+    passedLog.setEnabled(false);
+    BatchSimulator trace;
+    trace.generateTrace(2000000, 42);
 
-    void setInputMode() {
-    cout << "1. Use Linked List." << endl;
-    cout << "2. Use Array." << endl;
-    cout << "Enter choice: ";
-    cin >> inputMode;
-    if (inputMode != 1 && inputMode != 2) {
-        cout << "Invalid choice. Defaulting to Linked List." << endl;
-        inputMode = 1;
-    } else {
-        cout << (inputMode == 1 ? "Using Linked List" : "Using Array") << " for lane management." << endl;
+    vector<double> times[2][2]; // [grid/batch][off/on]
+    vector<double> overheads[2];
+    for (int r = 0; r < repeats; r++) {
+        for (int step = 0; step < 2; step++) {
+            int on = (step + r) % 2;  // swap the order every repeat
+            CityGrid<ListQue> grid(side, side, 20, 30, 42);
+            if (on) grid.enableMetrics(1);
+            auto startTime = chrono::steady_clock::now();
+            grid.run(ticks, 1);
+            times[0][on].push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count());
+
+            Road<ListQue> road;
+            RoadMetrics metrics;
+            if (on) road.attachMetrics(&metrics);
+            BatchSimulator batch;
+            batch.events = trace.events;
+            batch.run(road);
+            times[1][on].push_back(batch.runMs);
+        }
+        for (int k = 0; k < 2; k++) overheads[k].push_back(100.0 * (times[k][1][r] - times[k][0][r]) / times[k][0][r]);
+    }
+    const char* names[2] = {"Grid (Pop path)", "Batch (Dequeue path)"};
+    cout << "Median of " << repeats << " runs, metrics off vs on:" << endl;
+    for (int k = 0; k < 2; k++) {
+        cout << names[k] << ": " << medianOf(times[k][0]) << " ms vs " << medianOf(times[k][1]) << " ms, overhead "
+             << medianOf(overheads[k]) << "%" << endl;
     }
+    return 0;
 }
 
+void printBatchUsage() {
+    cout << "Usage:" << endl;
+    cout << "  Traffic_Management --batch <trace-file> [--mode list|array]" << endl;
+    cout << "  Traffic_Management --batch --synthetic <events> [--seed N] [--write-trace <file>] [--mode list|array]" << endl;
+    cout << "Options: --flush-ms <ms> and --flush-bytes <bytes> tune the passed-vehicle log" << endl;
+    cout << "         --lane-cap <n> makes array lanes bounded at n vehicles (rounded up to a power of two)" << endl;
+    cout << "         --timings <red> <green> <yellow> sets the signal cycle in seconds (default 10 15 5)" << endl;
+    cout << "         --restore <file> starts from a saved road, --snapshot <file> saves the road at the end" << endl;
+    cout << "         --metrics <file.json> records per-lane depth, waits and throughput (--metrics-ms <ms> between reports)" << endl;
+    cout << "         --pass-log <file> records passed vehicles in the columnar log instead of the text one (see --query-log)" << endl;
+    cout << "Trace lines: 'A <id> <Truck|Car|Bike>', 'D <Truck|Car|Bike>', 'T <seconds>', 'P <id>' (promote), 'R <id>' (remove)" << endl;
+}
 
-    void AddVehiclesToLane(Vehicles vehicle) {
+// Settings for one batch run besides the trace itself
+struct BatchOptions {
+    long long laneCapacity = 0;
+    int timings[3] = {10, 15, 5};
+    string restoreFile, snapshotFile;
+    string metricsFile;    // per-lane metrics JSON, rewritten every metricsMs
+    int metricsMs = 1000;
+    string passLogFile;    // columnar passed-vehicle log, replaces the text one for the run
+};
 
-        if (vehicle.type != "Truck" && vehicle.type != "Car" && vehicle.type != "Bike") {
-        cout << "Invalid vehicle type. Please enter Truck, Car, or Bike." << endl;
-        return;
+template <class Lane>
+int runBatchOn(BatchSimulator& simulator, const BatchOptions& options) {
+    Road<Lane> road;
+    if (options.laneCapacity > 0 && !road.setLaneCapacity((size_t)options.laneCapacity, false)) {
+        cout << "Note: --lane-cap only applies to array lanes." << endl;
     }
-        if (inputMode == 1) {
-            if (vehicle.type == "Truck") {
-                TruckLane_list.Enqueue(vehicle);
-            } else if (vehicle.type == "Car") {
-                CarLane_list.Enqueue(vehicle);
-            } else if (vehicle.type == "Bike") {
-                BikeLane_list.Enqueue(vehicle);
-            } else {
-                cout << "Unknown Vehicle type" << endl;
-            }
-        } else if (inputMode == 2) {
-            if (vehicle.type == "Truck") {
-                TruckLane_array.Enqueue(vehicle);
-            } else if (vehicle.type == "Car") {
-                CarLane_array.Enqueue(vehicle);
-            } else if (vehicle.type == "Bike") {
-                BikeLane_array.Enqueue(vehicle);
-            } else {
-                cout << "Unknown Vehicle type" << endl;
-            }
+    road.setSignalTimings(options.timings[0], options.timings[1], options.timings[2]);
+    if (!options.restoreFile.empty()) {
+        // the snapshot's signal timings replace --timings
+        MappedFile file;
+        if (!file.open(options.restoreFile)) {
+            cout << "Error: Unable to open " << options.restoreFile << endl;
+            return 1;
+        }
+        SnapshotReader in(file.Data(), file.Size());
+        string problem = in.open();
+        if (problem.empty() && !road.loadState(in)) problem = "not a valid road snapshot";
+        if (!problem.empty()) {
+            cout << "Error: " << options.restoreFile << ": " << problem << endl;
+            return 1;
         }
     }
-
-    void DequeueVehiclesFromLanes(string LaneType) {
-        if (inputMode == 1) {
-            if (LaneType == "Truck") {
-                if (TruckSignal.canPass()) {
-                    TruckLane_list.Dequeue();
-                } else {
-                    cout << "Truck Lane Signal is not Green! Please wait" << endl;
-                }
-            } else if (LaneType == "Car") {
-                if (CarSignal.canPass()) {
-                    CarLane_list.Dequeue();
-                } else {
-                    cout << "Car Lane Signal is not Green! Please wait" << endl;
-                }
-            } else if (LaneType == "Bike") {
-                if (BikeSignal.canPass()) {
-                    BikeLane_list.Dequeue();
-                } else {
-                    cout << "Bike Lane Signal is not Green! Please wait" << endl;
-                }
-            }
-        } else if (inputMode == 2) {
-            if (LaneType == "Truck") {
-                if (TruckSignal.canPass()) {
-                    TruckLane_array.Dequeue();
-                } else {
-                    cout << "Truck Lane Signal is not Green! Please wait" << endl;
-                }
-            } else if (LaneType == "Car") {
-                if (CarSignal.canPass()) {
-                    CarLane_array.Dequeue();
-                } else {
-                    cout << "Car Lane Signal is not Green! Please wait" << endl;
-                }
-            } else if (LaneType == "Bike") {
-                if (BikeSignal.canPass()) {
-                    BikeLane_array.Dequeue();
-                } else {
-                    cout << "Bike Lane Signal is not Green! Please wait" << endl;
-                }
-            }
+    RoadMetrics metrics;
+    vector<RoadMetrics*> sources;
+    if (!options.metricsFile.empty()) {
+        road.attachMetrics(&metrics);
+        sources.push_back(&metrics);
+    }
+    MetricsReporter reporter(sources, options.metricsFile, options.metricsMs);
+    PassLogFile passLogFile;
+    PassLogWriter passLog(&passLogFile);
+    if (!options.passLogFile.empty()) {
+        if (!passLogFile.open(options.passLogFile)) return 1;
+        road.attachPassLog(&passLog);
+        passedLog.setEnabled(false);
+    }
+    if (simulator.usesIds) road.enableVehicleIndex();
+    simulator.run(road);
+    reporter.finish();
+    passLog.flush();
+    auto flushStart = chrono::steady_clock::now();
+    passedLog.shutdown();
+    double flushMs = chrono::duration<double, milli>(chrono::steady_clock::now() - flushStart).count();
+    simulator.printReport(road);
+    cout << "Final log flush: " << flushMs << " ms" << endl;
+    if (!options.passLogFile.empty()) printPassLogSummary(passLogFile, options.passLogFile);
+    if (!sources.empty()) {
+        reporter.printTable();
+        reporter.printSummary();
+    }
+    if (!options.snapshotFile.empty()) {
+        vector<char> buffer;
+        road.saveState(buffer);
+        if (!writeSnapshotFile(options.snapshotFile, buffer)) {
+            cout << "Error: could not write snapshot " << options.snapshotFile << endl;
+            return 1;
         }
     }
+    return 0;
+}
 
-    void DisplayAllLanes() {
-        if (inputMode == 1) {
-            cout << "\nTrucks Lane (Linked List): ";
-            TruckLane_list.Display();
-
-            cout << "\nCars Lane (Linked List): ";
-            CarLane_list.Display();
-
-            cout << "\nBikes Lane (Linked List): ";
-            BikeLane_list.Display();
-        } else if (inputMode == 2) {
-            cout << "\nTrucks Lane (Array): ";
-            TruckLane_array.Display();
-
-            cout << "\nCars Lane (Array): ";
-            CarLane_array.Display();
-
-            cout << "\nBikes Lane (Array): ";
-            BikeLane_array.Display();
+int runBatch(int argc, char* argv[]) {
+    string traceFile, writeFile;
+    long long syntheticEvents = -1;
+    unsigned seed = 42;
+    int mode = 1;
+    BatchOptions options;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--synthetic" && i + 1 < argc) {
+            syntheticEvents = atoll(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = (unsigned)atol(argv[++i]);
+        } else if (arg == "--write-trace" && i + 1 < argc) {
+            writeFile = argv[++i];
+        } else if (arg == "--flush-ms" && i + 1 < argc) {
+            passedLog.configure(atoi(argv[++i]), 0);
+        } else if (arg == "--flush-bytes" && i + 1 < argc) {
+            passedLog.configure(0, (size_t)atoll(argv[++i]));
+        } else if (arg == "--timings" && i + 3 < argc) {
+            for (int k = 0; k < 3; k++) options.timings[k] = atoi(argv[++i]);
+        } else if (arg == "--restore" && i + 1 < argc) {
+            options.restoreFile = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            options.snapshotFile = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            options.metricsFile = argv[++i];
+        } else if (arg == "--metrics-ms" && i + 1 < argc) {
+            options.metricsMs = atoi(argv[++i]);
+        } else if (arg == "--pass-log" && i + 1 < argc) {
+            options.passLogFile = argv[++i];
+        } else if (arg == "--lane-cap" && i + 1 < argc) {
+            options.laneCapacity = atoll(argv[++i]);
+        } else if (arg == "--mode" && i + 1 < argc) {
+            string value = argv[++i];
+            mode = (value == "array") ? 2 : 1;
+        } else if (!arg.empty() && arg[0] != '-' && traceFile.empty()) {
+            traceFile = arg;
+        } else {
+            printBatchUsage();
+            return 1;
         }
     }
-
-    void updateAllSignals(int elapsedTime) {
-        TruckSignal.changeSignal(elapsedTime);
-        CarSignal.changeSignal(elapsedTime);
-        BikeSignal.changeSignal(elapsedTime);
+    if (traceFile.empty() && syntheticEvents < 0) {
+        printBatchUsage();
+        return 1;
     }
 
-    void displayAllSignals() {
-        cout << "\nTruck lane Signal: ";
-        TruckSignal.displaySignal();
-
-        cout << "Car Lane Signal: ";
-        CarSignal.displaySignal();
+    quietMode = true;
+    BatchSimulator simulator;
+    if (syntheticEvents >= 0) {
+        simulator.generateTrace(syntheticEvents, seed);
+        if (!writeFile.empty() && !simulator.writeTrace(writeFile)) return 1;
+    } else if (!simulator.loadTrace(traceFile)) {
+        return 1;
+    }
+    if (mode == 2) return runBatchOn<ArrayQue>(simulator, options);
+    return runBatchOn<ListQue>(simulator, options);
+}
 
-        cout << "Bike lane Signal: ";
-        BikeSignal.displaySignal();
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--batch") {
+        return runBatch(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--grid") {
+        return runGrid(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--restore") {
+        return runGridRestore(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--events") {
+        return runEventSimulation(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-ingest") {
+        return runIngestBenchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-metrics") {
+        return runMetricsBenchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-signals") {
+        return runSignalBenchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-lanes") {
+        return runLaneBenchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-render") {
+        return runRenderBenchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--query-log") {
+        return runPassLogQuery(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-index") {
+        return runIndexBenchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-pool") {
+        return runPoolBenchmark(argc, argv);
     }
-};
 
-int main() {
     system("CLS");
-    Road road;
-    road.setInputMode();
+    RoadBase* road = makeRoad(chooseInputMode());
+    road->enableVehicleIndex();
 
     int choice;
     do {
@@ -394,7 +4973,10 @@ int main() {
         cout << "3. Display All Lanes" << endl;
         cout << "4. Update Traffic Signals" << endl;
         cout << "5. Display Traffic Signals" << endl;
-        cout << "6. Exit" << endl;
+        cout << "6. Find Vehicle" << endl;
+        cout << "7. Promote Emergency Vehicle to Front" << endl;
+        cout << "8. Remove Vehicle by ID" << endl;
+        cout << "9. Exit" << endl;
         cout << "Enter your choice: ";
         cin >> choice;
 
@@ -405,7 +4987,7 @@ int main() {
             cin >> id;
             cout << "Enter Vehicle Type (Truck/Car/Bike): ";
             cin >> type;
-            road.AddVehiclesToLane(Vehicles(id, type));
+            road->AddVehiclesToLane(Vehicles(id, type));
             break;
         }
 
@@ -413,34 +4995,88 @@ int main() {
             string laneType;
             cout << "Enter Lane Type to Remove Vehicle (Truck/Car/Bike): ";
             cin >> laneType;
-            road.DequeueVehiclesFromLanes(laneType);
+            road->DequeueVehiclesFromLanes(laneType);
             break;
         }
 
-        case 3:
-            road.DisplayAllLanes();
+        case 3: {
+            DisplayOptions options;
+            int view;
+            cout << "1. Summary (vehicles per lane)" << endl;
+            cout << "2. First N vehicles of each lane" << endl;
+            cout << "3. Last N vehicles of each lane" << endl;
+            cout << "4. Page of N vehicles" << endl;
+            cout << "Enter view: ";
+            cin >> view;
+            if (view < 1 || view > 4) {
+                cout << "Invalid view. Showing the first " << options.count << " vehicles." << endl;
+                view = 2;
+            }
+            options.view = (LaneView)(view - 1);
+            if (view != 1) {
+                long long count;
+                cout << "Vehicles per lane (N): ";
+                cin >> count;
+                if (count > 0) options.count = (size_t)count;
+            }
+            if (view == 4) {
+                long long page;
+                cout << "Page number (from 1): ";
+                cin >> page;
+                options.page = page > 1 ? (size_t)(page - 1) : 0;
+            }
+            road->DisplayAllLanes(options);
             break;
+        }
 
         case 4: { 
         int elapsedTime; 
         cout << "Enter elapsed time in seconds to update signals: "; 
         cin >> elapsedTime; 
-        road.updateAllSignals(elapsedTime); 
+        road->updateAllSignals(elapsedTime); 
         cout << "Signals updated!" << endl; 
         break; 
     }
         case 5:
-            road.displayAllSignals();
+            road->displayAllSignals();
             break;
 
         case 6:
+        case 7:
+        case 8: {
+            string plate;
+            cout << "Enter Vehicle ID: ";
+            cin >> plate;
+            uint64_t id;
+            Vehicles vehicle;
+            VehicleClass lane = INVALID_VEHICLE;
+            if (plateRegistry.find(plate, id)) lane = road->LocateVehicle(id, &vehicle);
+            if (lane == INVALID_VEHICLE) {
+                cout << "Vehicle " << plate << " is not waiting in any lane." << endl;
+            } else if (choice == 6) {
+                cout << "Found in the " << laneTypes[lane] << " Lane: ";
+                vehicle.displayInfo();
+                cout << " (arrived at " << road->clock - vehicle.waitedAt(road->clock) << "s)" << endl;
+            } else if (choice == 7) {
+                road->PromoteVehicle(id);
+                cout << "Vehicle " << plate << " moved to the front of the " << laneTypes[lane] << " Lane." << endl;
+            } else {
+                road->RemoveVehicle(id);
+                cout << "Vehicle " << plate << " removed from the " << laneTypes[lane] << " Lane." << endl;
+            }
+            break;
+        }
+
+        case 9:
+            passedLog.shutdown(); // Make sure every passed vehicle reaches the file
             cout << "Exiting the system. Goodbye!" << endl;
             break;
 
         default:
             cout << "Invalid choice! Please try again." << endl;
         }
-    } while (choice != 6);
+    } while (choice != 9);
 
+    delete road;
     return 0;
 }